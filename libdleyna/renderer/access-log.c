@@ -0,0 +1,145 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libdleyna/core/log.h>
+
+#include "access-log.h"
+
+struct dlr_access_log_t_ {
+	gchar *path;
+	FILE *file;
+	gsize size;
+	gsize max_size;
+	guint max_files;
+};
+
+static gboolean prv_open(dlr_access_log_t *log)
+{
+	long size;
+
+	log->file = g_fopen(log->path, "a");
+	if (!log->file) {
+		DLEYNA_LOG_WARNING("Unable to open access log %s: %s",
+				   log->path, g_strerror(errno));
+		goto on_error;
+	}
+
+	size = ftell(log->file);
+	log->size = size > 0 ? size : 0;
+
+	return TRUE;
+
+on_error:
+
+	return FALSE;
+}
+
+static void prv_rotate(dlr_access_log_t *log)
+{
+	gchar *from;
+	gchar *to;
+	guint i;
+
+	(void) fclose(log->file);
+	log->file = NULL;
+
+	/* The oldest file is overwritten by the one before it, and so
+	   on down to the current log, which becomes path.1.  Without any
+	   files to keep the log just starts again. */
+
+	if (log->max_files == 0) {
+		(void) g_unlink(log->path);
+	} else {
+		for (i = log->max_files; i > 0; --i) {
+			from = i > 1 ? g_strdup_printf("%s.%u", log->path,
+						       i - 1) :
+				g_strdup(log->path);
+			to = g_strdup_printf("%s.%u", log->path, i);
+			(void) g_rename(from, to);
+			g_free(to);
+			g_free(from);
+		}
+	}
+
+	(void) prv_open(log);
+}
+
+dlr_access_log_t *dlr_access_log_new(const gchar *path, gsize max_size,
+				     guint max_files)
+{
+	dlr_access_log_t *log;
+	gchar *dir;
+
+	log = g_new0(dlr_access_log_t, 1);
+	log->path = g_strdup(path);
+	log->max_size = max_size;
+	log->max_files = max_files;
+
+	dir = g_path_get_dirname(path);
+	(void) g_mkdir_with_parents(dir, 0700);
+	g_free(dir);
+
+	if (!prv_open(log)) {
+		dlr_access_log_delete(log);
+		log = NULL;
+	}
+
+	return log;
+}
+
+void dlr_access_log_write(dlr_access_log_t *log, const gchar *line)
+{
+	gsize length = strlen(line);
+
+	if (log->max_size && log->size > 0 &&
+	    log->size + length + 1 > log->max_size)
+		prv_rotate(log);
+
+	if (!log->file)
+		goto on_exit;
+
+	/* Each record is flushed straight away so that the log can be
+	   followed while files are being served. */
+
+	(void) fprintf(log->file, "%s\n", line);
+	(void) fflush(log->file);
+	log->size += length + 1;
+
+on_exit:
+
+	return;
+}
+
+void dlr_access_log_delete(dlr_access_log_t *log)
+{
+	if (log) {
+		if (log->file)
+			(void) fclose(log->file);
+
+		g_free(log->path);
+		g_free(log);
+	}
+}
@@ -0,0 +1,35 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef DLR_ACCESS_LOG_H__
+#define DLR_ACCESS_LOG_H__
+
+#include <glib.h>
+
+typedef struct dlr_access_log_t_ dlr_access_log_t;
+
+dlr_access_log_t *dlr_access_log_new(const gchar *path, gsize max_size,
+				     guint max_files);
+
+void dlr_access_log_write(dlr_access_log_t *log, const gchar *line);
+
+void dlr_access_log_delete(dlr_access_log_t *log);
+
+#endif /* DLR_ACCESS_LOG_H__ */
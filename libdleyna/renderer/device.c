@@ -35,6 +35,8 @@
 
 #include "async.h"
 #include "device.h"
+#include "image-scaler.h"
+#include "last-change.h"
 #include "prop-defs.h"
 #include "server.h"
 
@@ -52,6 +54,17 @@ struct dlr_device_data_t_ {
 	} ut;
 };
 
+/* Property changes of one interface waiting to be signalled.  keys
+   holds the names in the order in which they first changed, and points
+   into values. */
+
+typedef struct dlr_device_changes_t_ dlr_device_changes_t;
+struct dlr_device_changes_t_ {
+	const char *interface;
+	GPtrArray *keys;
+	GHashTable *values;
+};
+
 typedef struct dlr_rc_event_t_ dlr_rc_event_t;
 struct dlr_rc_event_t_ {
 	dlr_device_t *device;
@@ -74,6 +87,59 @@ struct prv_download_info_t_ {
 	dlr_async_task_t *task;
 };
 
+typedef struct prv_host_uris_t_ prv_host_uris_t;
+
+typedef struct prv_host_uris_item_t_ prv_host_uris_item_t;
+struct prv_host_uris_item_t_ {
+	prv_host_uris_t *batch;
+	guint index;
+};
+
+struct prv_host_uris_t_ {
+	dlr_async_task_t *task;
+	guint pending;
+	gchar **urls;
+	GVariantBuilder *errors;
+	prv_host_uris_item_t *items;
+};
+
+/* The LastChange variables that are followed, in the order in which they
+   are given to the parsers. */
+
+enum dlr_av_var_t_ {
+	DLR_AV_VAR_META_DATA,
+	DLR_AV_VAR_ACTIONS,
+	DLR_AV_VAR_PLAY_SPEED,
+	DLR_AV_VAR_STATE,
+	DLR_AV_VAR_DURATION,
+	DLR_AV_VAR_URI,
+	DLR_AV_VAR_NUMBER_OF_TRACKS,
+	DLR_AV_VAR_CURRENT_TRACK
+};
+
+static const gchar *const g_av_last_change_vars[] = {
+	"CurrentTrackMetaData",
+	"CurrentTransportActions",
+	"TransportPlaySpeed",
+	"TransportState",
+	"CurrentTrackDuration",
+	"CurrentTrackURI",
+	"NumberOfTracks",
+	"CurrentTrack",
+	NULL
+};
+
+enum dlr_rc_var_t_ {
+	DLR_RC_VAR_VOLUME,
+	DLR_RC_VAR_MUTE
+};
+
+static const gchar *const g_rc_last_change_vars[] = {
+	"Volume",
+	"Mute",
+	NULL
+};
+
 static void prv_last_change_cb(GUPnPServiceProxy *proxy,
 			       const char *variable,
 			       GValue *value,
@@ -96,40 +162,46 @@ static void prv_get_rates_values(GList *allowed_tp_speeds,
 				 GPtrArray **upnp_tp_speeds,
 				 double *min_rate, double *max_rate);
 
-static void prv_add_player_speed_props(GHashTable *player_props,
+static void prv_add_player_speed_props(dlr_prop_store_t *player_props,
 				       double min_rate, double max_rate,
 				       GVariant *mpris_transport_play_speeds,
 				       GVariantBuilder *changed_props_vb);
 
 static gint prv_compare_rationals(const gchar *a, const gchar *b);
 
+static void prv_update_meta_data(dlr_device_t *device,
+				 GVariantBuilder *changed_props_vb);
+
 static void prv_get_position_info(dlr_async_task_t *cb_data,
 				  const gchar *action_name,
 				  GUPnPServiceProxyActionCallback callback);
 
-static void prv_unref_variant(gpointer variant)
-{
-	GVariant *var = variant;
-	if (var)
-		g_variant_unref(var);
-}
+static GQuark g_device_quark;
+static GQuark g_server_quark;
+static GQuark g_player_quark;
 
 static void prv_props_init(dlr_props_t *props)
 {
-	props->root_props = g_hash_table_new_full(g_str_hash, g_str_equal,
-						  NULL, prv_unref_variant);
-	props->player_props = g_hash_table_new_full(g_str_hash, g_str_equal,
-						    NULL, prv_unref_variant);
-	props->device_props = g_hash_table_new_full(g_str_hash, g_str_equal,
-						    NULL, prv_unref_variant);
+	if (!g_device_quark) {
+		g_device_quark = g_quark_from_static_string(
+				DLEYNA_SERVER_INTERFACE_RENDERER_DEVICE);
+		g_server_quark = g_quark_from_static_string(
+				DLR_INTERFACE_SERVER);
+		g_player_quark = g_quark_from_static_string(
+				DLR_INTERFACE_PLAYER);
+	}
+
+	props->root_props = dlr_prop_store_new(&dlr_prop_root_table);
+	props->player_props = dlr_prop_store_new(&dlr_prop_player_table);
+	props->device_props = dlr_prop_store_new(&dlr_prop_device_table);
 	props->synced = FALSE;
 }
 
 static void prv_props_free(dlr_props_t *props)
 {
-	g_hash_table_unref(props->root_props);
-	g_hash_table_unref(props->player_props);
-	g_hash_table_unref(props->device_props);
+	dlr_prop_store_delete(props->root_props);
+	dlr_prop_store_delete(props->player_props);
+	dlr_prop_store_delete(props->device_props);
 }
 
 static void prv_service_proxies_free(dlr_service_proxies_t *service_proxies)
@@ -208,27 +280,43 @@ static void prv_dlr_context_delete(gpointer context)
 	}
 }
 
-static void prv_change_props(GHashTable *props,
-			     const gchar *key,
+static void prv_change_props(dlr_prop_store_t *props,
+			     guint id,
 			     GVariant *value,
 			     GVariantBuilder *changed_props_vb)
 {
-	g_hash_table_insert(props, (gpointer) key, value);
+	GVariant *current = dlr_prop_store_get(props, id);
+
+	/* Renderers repeat most state variables in every event, so values
+	   that have not changed are dropped rather than signalled again. */
+
+	if (current && (current == value || g_variant_equal(current, value))) {
+		g_variant_unref(value);
+		goto on_exit;
+	}
+
+	dlr_prop_store_set(props, id, value);
 	if (changed_props_vb)
-		g_variant_builder_add(changed_props_vb, "{sv}", key, value);
+		g_variant_builder_add(changed_props_vb, "{sv}",
+				      dlr_prop_store_get_name(props, id),
+				      value);
+
+on_exit:
+
+	return;
 }
 
-static void prv_emit_signal_properties_changed(dlr_device_t *device,
-					       const char *interface,
-					       GVariant *changed_props)
+static void prv_notify_properties_changed(dlr_device_t *device,
+					  const char *interface,
+					  GVariant *changed_props)
 {
 #if DLEYNA_LOG_LEVEL & DLEYNA_LOG_LEVEL_DEBUG
 	gchar *params;
 #endif
-	GVariant *val = g_variant_ref_sink(g_variant_new("(s@a{sv}as)",
-					   interface,
-					   changed_props,
-					   NULL));
+	GVariant *val;
+
+	val = g_variant_ref_sink(g_variant_new("(s@a{sv}as)", interface,
+					       changed_props, NULL));
 
 	DLEYNA_LOG_DEBUG("Emitted Signal: %s.%s - ObjectPath: %s",
 			 DLR_INTERFACE_PROPERTIES,
@@ -251,6 +339,172 @@ static void prv_emit_signal_properties_changed(dlr_device_t *device,
 	g_variant_unref(val);
 }
 
+static void prv_device_changes_delete(gpointer device_changes)
+{
+	dlr_device_changes_t *changes = device_changes;
+
+	if (changes) {
+		g_ptr_array_unref(changes->keys);
+		g_hash_table_unref(changes->values);
+		g_free(changes);
+	}
+}
+
+static dlr_device_changes_t *prv_get_changes(dlr_device_t *device,
+					     const char *interface)
+{
+	dlr_device_changes_t *changes;
+	guint i;
+
+	for (i = 0; i < device->pending_changes->len; ++i) {
+		changes = g_ptr_array_index(device->pending_changes, i);
+		if (!strcmp(changes->interface, interface))
+			goto on_exit;
+	}
+
+	changes = g_new0(dlr_device_changes_t, 1);
+	changes->interface = interface;
+	changes->keys = g_ptr_array_new();
+	changes->values = g_hash_table_new_full(
+					g_str_hash, g_str_equal, g_free,
+					(GDestroyNotify) g_variant_unref);
+	g_ptr_array_add(device->pending_changes, changes);
+
+on_exit:
+
+	return changes;
+}
+
+static void prv_queue_properties_changed(dlr_device_t *device,
+					 const char *interface,
+					 GVariant *changed_props)
+{
+	dlr_device_changes_t *changes;
+	GVariantIter iter;
+	const gchar *key;
+	GVariant *value;
+	gchar *stored;
+
+	if (g_variant_n_children(changed_props) == 0)
+		goto on_exit;
+
+	changes = prv_get_changes(device, interface);
+	g_variant_iter_init(&iter, changed_props);
+
+	while (g_variant_iter_next(&iter, "{&sv}", &key, &value)) {
+		stored = g_strdup(key);
+
+		if (!g_hash_table_contains(changes->values, key))
+			g_ptr_array_add(changes->keys, stored);
+
+		g_hash_table_insert(changes->values, stored, value);
+	}
+
+on_exit:
+
+	return;
+}
+
+static void prv_flush_meta_data(dlr_device_t *device)
+{
+	GVariantBuilder vb;
+	GVariant *changed_props;
+
+	if (!device->meta_data.pending)
+		goto on_exit;
+
+	g_variant_builder_init(&vb, G_VARIANT_TYPE("a{sv}"));
+	prv_update_meta_data(device, &vb);
+	changed_props = g_variant_ref_sink(g_variant_builder_end(&vb));
+	prv_queue_properties_changed(device, DLR_INTERFACE_PLAYER,
+				     changed_props);
+	g_variant_unref(changed_props);
+
+on_exit:
+
+	return;
+}
+
+static gboolean prv_flush_properties_changed(gpointer user_data)
+{
+	dlr_device_t *device = user_data;
+	dlr_device_changes_t *changes;
+	GVariantBuilder vb;
+	GVariant *changed_props;
+	const gchar *key;
+	guint i;
+	guint j;
+
+	device->changes_id = 0;
+
+	prv_flush_meta_data(device);
+
+	for (i = 0; i < device->pending_changes->len; ++i) {
+		changes = g_ptr_array_index(device->pending_changes, i);
+
+		if (changes->keys->len == 0)
+			continue;
+
+		g_variant_builder_init(&vb, G_VARIANT_TYPE("a{sv}"));
+
+		for (j = 0; j < changes->keys->len; ++j) {
+			key = g_ptr_array_index(changes->keys, j);
+			g_variant_builder_add(
+				&vb, "{sv}", key,
+				g_hash_table_lookup(changes->values, key));
+		}
+
+		changed_props = g_variant_ref_sink(g_variant_builder_end(&vb));
+		prv_notify_properties_changed(device, changes->interface,
+					      changed_props);
+		g_variant_unref(changed_props);
+
+		g_ptr_array_set_size(changes->keys, 0);
+		g_hash_table_remove_all(changes->values);
+	}
+
+	return FALSE;
+}
+
+static void prv_schedule_properties_changed(dlr_device_t *device)
+{
+	if (device->changes_id)
+		goto on_exit;
+
+	if (device->changes_delay)
+		device->changes_id = g_timeout_add(
+						device->changes_delay,
+						prv_flush_properties_changed,
+						device);
+	else
+		device->changes_id = g_idle_add(prv_flush_properties_changed,
+						device);
+
+on_exit:
+
+	return;
+}
+
+static void prv_emit_signal_properties_changed(dlr_device_t *device,
+					       const char *interface,
+					       GVariant *changed_props)
+{
+	/* A track change is usually reported in several events in a row.
+	   Their changes are merged, per interface, into a single signal
+	   sent at the end of the delay.  Properties keep the order in
+	   which they first changed and the latest value is sent. */
+
+	if (g_variant_n_children(changed_props) == 0)
+		goto on_exit;
+
+	prv_queue_properties_changed(device, interface, changed_props);
+	prv_schedule_properties_changed(device);
+
+on_exit:
+
+	return;
+}
+
 static void prv_merge_meta_data(dlr_device_t *device,
 				const gchar *key,
 				GVariant *value,
@@ -264,10 +518,12 @@ static void prv_merge_meta_data(dlr_device_t *device,
 	gboolean replaced = FALSE;
 	GVariant *new_val;
 
+	prv_update_meta_data(device, changed_props_vb);
+
 	vb = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
 
-	current_meta_data = g_hash_table_lookup(device->props.player_props,
-						DLR_INTERFACE_PROP_METADATA);
+	current_meta_data = dlr_prop_store_get(device->props.player_props,
+					       DLR_PLAYER_PROP_METADATA);
 	if (current_meta_data) {
 		g_variant_iter_init(&viter, current_meta_data);
 		while (g_variant_iter_next(&viter, "{&sv}", &vkey, &val)) {
@@ -287,7 +543,7 @@ static void prv_merge_meta_data(dlr_device_t *device,
 
 	val = g_variant_ref_sink(g_variant_builder_end(vb));
 	prv_change_props(device->props.player_props,
-			 DLR_INTERFACE_PROP_METADATA,
+			 DLR_PLAYER_PROP_METADATA,
 			 val,
 			 changed_props_vb);
 	g_variant_builder_unref(vb);
@@ -399,6 +655,10 @@ void dlr_device_delete(void *device)
 		if (dev->timeout_id)
 			(void) g_source_remove(dev->timeout_id);
 
+		if (dev->changes_id)
+			(void) g_source_remove(dev->changes_id);
+		g_ptr_array_unref(dev->pending_changes);
+
 		for (i = 0; i < DLR_INTERFACE_INFO_MAX && dev->ids[i]; ++i)
 			(void) dlr_renderer_get_connector()->unpublish_object(
 								dev->connection,
@@ -414,8 +674,17 @@ void dlr_device_delete(void *device)
 		if (dev->mpris_transport_play_speeds)
 			g_variant_unref(dev->mpris_transport_play_speeds);
 		g_hash_table_unref(dev->rc_event_handlers);
+		dlr_last_change_delete(dev->av_last_change);
+		dlr_last_change_delete(dev->rc_last_change);
 		g_free(dev->rate);
 
+		if (dev->meta_data.items)
+			g_variant_unref(dev->meta_data.items);
+		g_free(dev->meta_data.didl);
+		g_free(dev->meta_data.pending_didl);
+		g_free(dev->meta_data.duration);
+		g_free(dev->meta_data.uri);
+
 		g_free(dev->icon.mime_type);
 		g_free(dev->icon.bytes);
 
@@ -596,8 +865,8 @@ void dlr_device_subscribe_to_service_changes(dlr_device_t *device)
 	}
 }
 
-static void prv_as_prop_from_hash_table(const gchar *prop_name,
-					GHashTable *values, GHashTable *props)
+static void prv_as_prop_from_hash_table(guint id, GHashTable *values,
+					dlr_prop_store_t *props)
 {
 	GVariantBuilder vb;
 	GHashTableIter iter;
@@ -611,7 +880,7 @@ static void prv_as_prop_from_hash_table(const gchar *prop_name,
 		g_variant_builder_add(&vb, "s", key);
 
 	val = g_variant_ref_sink(g_variant_builder_end(&vb));
-	g_hash_table_insert(props, (gchar *)prop_name, val);
+	dlr_prop_store_set(props, id, val);
 }
 
 static void prv_process_protocol_info(dlr_device_t *device,
@@ -633,16 +902,22 @@ static void prv_process_protocol_info(dlr_device_t *device,
 	types = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 
 	val = g_variant_ref_sink(g_variant_new_string(protocol_info));
-	g_hash_table_insert(device->props.device_props,
-			    DLR_INTERFACE_PROP_PROTOCOL_INFO,
-			    val);
+	dlr_prop_store_set(device->props.device_props,
+			   DLR_DEVICE_PROP_PROTOCOL_INFO,
+			   val);
 
 	entries = g_strsplit(protocol_info, ",", 0);
+	device->can_play_local_files = FALSE;
+	device->image_profile =
+		dlr_image_profile_from_protocol_info(protocol_info);
 
 	for (i = 0; entries[i]; ++i) {
 		type_info = g_strsplit(entries[i], ":", 0);
 
 		if (type_info[0] && type_info[1] && type_info[2]) {
+			if (!g_ascii_strcasecmp(type_info[0], "file"))
+				device->can_play_local_files = TRUE;
+
 			if (!g_ascii_strncasecmp(http_prefix, type_info[0],
 						 sizeof(http_prefix) - 1)) {
 				type_info[0][sizeof(http_prefix) - 2] = 0;
@@ -661,11 +936,11 @@ static void prv_process_protocol_info(dlr_device_t *device,
 
 	g_strfreev(entries);
 
-	prv_as_prop_from_hash_table(DLR_INTERFACE_PROP_SUPPORTED_URIS,
+	prv_as_prop_from_hash_table(DLR_ROOT_PROP_SUPPORTED_URIS,
 				    protocols,
 				    device->props.root_props);
 
-	prv_as_prop_from_hash_table(DLR_INTERFACE_PROP_SUPPORTED_MIME,
+	prv_as_prop_from_hash_table(DLR_ROOT_PROP_SUPPORTED_MIME,
 				    types,
 				    device->props.root_props);
 
@@ -834,7 +1109,8 @@ dlr_device_t *dlr_device_new(
 			const gchar *ip_address,
 			const char *udn,
 			const dleyna_connector_dispatch_cb_t *dispatch_table,
-			const dleyna_task_queue_key_t *queue_id)
+			const dleyna_task_queue_key_t *queue_id,
+			guint changes_delay)
 {
 	dlr_device_t *dev;
 	gchar *new_path;
@@ -858,6 +1134,11 @@ dlr_device_t *dlr_device_new(
 	dev->rc_event_handlers = g_hash_table_new_full(g_int_hash, g_int_equal,
 						       g_free,
 						       prv_free_rc_event);
+	dev->changes_delay = changes_delay;
+	dev->pending_changes = g_ptr_array_new_with_free_func(
+						prv_device_changes_delete);
+	dev->av_last_change = dlr_last_change_new(g_av_last_change_vars);
+	dev->rc_last_change = dlr_last_change_new(g_rc_last_change_vars);
 
 	prv_props_init(&dev->props);
 
@@ -892,18 +1173,24 @@ dlr_device_t *dlr_device_from_path(const gchar *path, GHashTable *device_list)
 	return retval;
 }
 
+static gboolean prv_is_local_context(dlr_device_context_t *context)
+{
+	const char ip4_local_prefix[] = "127.0.0.";
+
+	return !strncmp(context->ip_address, ip4_local_prefix,
+			sizeof(ip4_local_prefix) - 1) ||
+		!strcmp(context->ip_address, "::1") ||
+		!strcmp(context->ip_address, "0:0:0:0:0:0:0:1");
+}
+
 dlr_device_context_t *dlr_device_get_context(dlr_device_t *device)
 {
 	dlr_device_context_t *context;
 	unsigned int i;
-	const char ip4_local_prefix[] = "127.0.0.";
 
 	for (i = 0; i < device->contexts->len; ++i) {
 		context = g_ptr_array_index(device->contexts, i);
-		if (!strncmp(context->ip_address, ip4_local_prefix,
-			     sizeof(ip4_local_prefix) - 1) ||
-		    !strcmp(context->ip_address, "::1") ||
-		    !strcmp(context->ip_address, "0:0:0:0:0:0:0:1"))
+		if (prv_is_local_context(context))
 			break;
 	}
 
@@ -916,32 +1203,33 @@ dlr_device_context_t *dlr_device_get_context(dlr_device_t *device)
 static void prv_get_prop(dlr_async_task_t *cb_data)
 {
 	dlr_task_get_prop_t *get_prop = &cb_data->task.ut.get_prop;
+	dlr_props_t *props = &cb_data->device->props;
+	GQuark interface = g_quark_try_string(get_prop->interface_name);
 	GVariant *res = NULL;
 
 	DLEYNA_LOG_DEBUG("Enter");
 
-	if (!strcmp(get_prop->interface_name,
-		    DLEYNA_SERVER_INTERFACE_RENDERER_DEVICE)) {
-		res = g_hash_table_lookup(cb_data->device->props.device_props,
-					  get_prop->prop_name);
-	} else if (!strcmp(get_prop->interface_name, DLR_INTERFACE_SERVER)) {
-		res = g_hash_table_lookup(cb_data->device->props.root_props,
-					  get_prop->prop_name);
-	} else if (!strcmp(get_prop->interface_name, DLR_INTERFACE_PLAYER)) {
-		res = g_hash_table_lookup(cb_data->device->props.player_props,
-					  get_prop->prop_name);
-	} else if (!strcmp(get_prop->interface_name, "")) {
-		res = g_hash_table_lookup(cb_data->device->props.root_props,
-					  get_prop->prop_name);
+	prv_flush_meta_data(cb_data->device);
+
+	if (interface == g_device_quark) {
+		res = dlr_prop_store_lookup(props->device_props,
+					    get_prop->prop_name);
+	} else if (interface == g_server_quark) {
+		res = dlr_prop_store_lookup(props->root_props,
+					    get_prop->prop_name);
+	} else if (interface == g_player_quark) {
+		res = dlr_prop_store_lookup(props->player_props,
+					    get_prop->prop_name);
+	} else if (!get_prop->interface_name[0]) {
+		res = dlr_prop_store_lookup(props->root_props,
+					    get_prop->prop_name);
 		if (!res)
-			res = g_hash_table_lookup(
-				cb_data->device->props.player_props,
-				get_prop->prop_name);
+			res = dlr_prop_store_lookup(props->player_props,
+						    get_prop->prop_name);
 
 		if (!res)
-			res = g_hash_table_lookup(
-				cb_data->device->props.device_props,
-				get_prop->prop_name);
+			res = dlr_prop_store_lookup(props->device_props,
+						    get_prop->prop_name);
 	} else {
 		cb_data->error = g_error_new(DLEYNA_SERVER_ERROR,
 					     DLEYNA_ERROR_UNKNOWN_INTERFACE,
@@ -961,40 +1249,30 @@ static void prv_get_prop(dlr_async_task_t *cb_data)
 	DLEYNA_LOG_DEBUG("Exit");
 }
 
-static void prv_add_props(GHashTable *props, GVariantBuilder *vb)
-{
-	GHashTableIter iter;
-	gpointer key;
-	gpointer value;
-
-	g_hash_table_iter_init(&iter, props);
-
-	while (g_hash_table_iter_next(&iter, &key, &value))
-		g_variant_builder_add(vb, "{sv}", (gchar *)key,
-				      (GVariant *)value);
-}
-
 static void prv_get_props(dlr_async_task_t *cb_data)
 {
 	dlr_task_get_props_t *get_props = &cb_data->task.ut.get_props;
+	dlr_props_t *props = &cb_data->device->props;
+	GQuark interface = g_quark_try_string(get_props->interface_name);
 	GVariantBuilder *vb;
 
 	DLEYNA_LOG_DEBUG("Enter");
 
+	prv_flush_meta_data(cb_data->device);
+
 	vb = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
 
-	if (!strcmp(get_props->interface_name,
-		    DLEYNA_SERVER_INTERFACE_RENDERER_DEVICE)) {
-		prv_add_props(cb_data->device->props.device_props, vb);
-	} else if (!strcmp(get_props->interface_name, DLR_INTERFACE_SERVER)) {
-		prv_add_props(cb_data->device->props.root_props, vb);
-		prv_add_props(cb_data->device->props.device_props, vb);
-	} else if (!strcmp(get_props->interface_name, DLR_INTERFACE_PLAYER)) {
-		prv_add_props(cb_data->device->props.player_props, vb);
-	} else if (!strcmp(get_props->interface_name, "")) {
-		prv_add_props(cb_data->device->props.root_props, vb);
-		prv_add_props(cb_data->device->props.player_props, vb);
-		prv_add_props(cb_data->device->props.device_props, vb);
+	if (interface == g_device_quark) {
+		dlr_prop_store_add_all(props->device_props, vb);
+	} else if (interface == g_server_quark) {
+		dlr_prop_store_add_all(props->root_props, vb);
+		dlr_prop_store_add_all(props->device_props, vb);
+	} else if (interface == g_player_quark) {
+		dlr_prop_store_add_all(props->player_props, vb);
+	} else if (!get_props->interface_name[0]) {
+		dlr_prop_store_add_all(props->root_props, vb);
+		dlr_prop_store_add_all(props->player_props, vb);
+		dlr_prop_store_add_all(props->device_props, vb);
 	} else {
 		cb_data->error = g_error_new(DLEYNA_SERVER_ERROR,
 					     DLEYNA_ERROR_UNKNOWN_INTERFACE,
@@ -1124,13 +1402,13 @@ static GVariant *prv_as_prop_from_list(GList *list)
 }
 
 static GVariant *prv_update_prop_dlna_device_classes(GUPnPDeviceInfo *proxy,
-						     GHashTable *props)
+						     dlr_prop_store_t *props)
 {
 	GVariant *retval;
 	GList *dlna_classes;
 
-	retval = g_hash_table_lookup(props,
-				     DLR_INTERFACE_PROP_DLNA_DEVICE_CLASSES);
+	retval = dlr_prop_store_get(props,
+				    DLR_DEVICE_PROP_DLNA_DEVICE_CLASSES);
 	if (retval)
 		goto on_exit;
 
@@ -1141,8 +1419,8 @@ static GVariant *prv_update_prop_dlna_device_classes(GUPnPDeviceInfo *proxy,
 		goto on_exit;
 
 	retval = prv_as_prop_from_list(dlna_classes);
-	g_hash_table_insert(props, DLR_INTERFACE_PROP_DLNA_DEVICE_CLASSES,
-			    retval);
+	dlr_prop_store_set(props, DLR_DEVICE_PROP_DLNA_DEVICE_CLASSES,
+			   retval);
 
 	g_list_free_full(dlna_classes, g_free);
 
@@ -1238,43 +1516,43 @@ static void prv_add_actions(dlr_device_t *device,
 
 	g_variant_ref(false_val);
 	prv_change_props(device->props.player_props,
-			 DLR_INTERFACE_PROP_CAN_CONTROL, false_val,
+			 DLR_PLAYER_PROP_CAN_CONTROL, false_val,
 			 changed_props_vb);
 
 	val = play ? true_val : false_val;
 	g_variant_ref(val);
 	prv_change_props(device->props.player_props,
-			 DLR_INTERFACE_PROP_CAN_PLAY, val,
+			 DLR_PLAYER_PROP_CAN_PLAY, val,
 			 changed_props_vb);
 
 	val = ppause ? true_val : false_val;
 	g_variant_ref(val);
 	prv_change_props(device->props.player_props,
-			 DLR_INTERFACE_PROP_CAN_PAUSE, val,
+			 DLR_PLAYER_PROP_CAN_PAUSE, val,
 			 changed_props_vb);
 
 	val = seek && !timeseek_missing ? true_val : false_val;
 	g_variant_ref(val);
 	prv_change_props(device->props.player_props,
-			 DLR_INTERFACE_PROP_CAN_SEEK, val,
+			 DLR_PLAYER_PROP_CAN_SEEK, val,
 			 changed_props_vb);
 
 	val = seek && byteseek ? true_val : false_val;
 	g_variant_ref(val);
 	prv_change_props(device->props.player_props,
-			 DLR_INTERFACE_PROP_CAN_BYTE_SEEK, val,
+			 DLR_PLAYER_PROP_CAN_BYTE_SEEK, val,
 			 changed_props_vb);
 
 	val = next ? true_val : false_val;
 	g_variant_ref(val);
 	prv_change_props(device->props.player_props,
-			 DLR_INTERFACE_PROP_CAN_NEXT, val,
+			 DLR_PLAYER_PROP_CAN_NEXT, val,
 			 changed_props_vb);
 
 	val = previous ? true_val : false_val;
 	g_variant_ref(val);
 	prv_change_props(device->props.player_props,
-			 DLR_INTERFACE_PROP_CAN_PREVIOUS, val,
+			 DLR_PLAYER_PROP_CAN_PREVIOUS, val,
 			 changed_props_vb);
 
 	g_variant_unref(true_val);
@@ -1289,22 +1567,22 @@ static void prv_add_all_actions(dlr_device_t *device,
 
 	val = g_variant_ref_sink(g_variant_new_boolean(TRUE));
 	prv_change_props(device->props.player_props,
-			 DLR_INTERFACE_PROP_CAN_PLAY, val,
+			 DLR_PLAYER_PROP_CAN_PLAY, val,
 			 changed_props_vb);
 	prv_change_props(device->props.player_props,
-			 DLR_INTERFACE_PROP_CAN_PAUSE, g_variant_ref(val),
+			 DLR_PLAYER_PROP_CAN_PAUSE, g_variant_ref(val),
 			 changed_props_vb);
 	prv_change_props(device->props.player_props,
-			 DLR_INTERFACE_PROP_CAN_SEEK, g_variant_ref(val),
+			 DLR_PLAYER_PROP_CAN_SEEK, g_variant_ref(val),
 			 changed_props_vb);
 	prv_change_props(device->props.player_props,
-			 DLR_INTERFACE_PROP_CAN_NEXT, g_variant_ref(val),
+			 DLR_PLAYER_PROP_CAN_NEXT, g_variant_ref(val),
 			 changed_props_vb);
 	prv_change_props(device->props.player_props,
-			 DLR_INTERFACE_PROP_CAN_PREVIOUS, g_variant_ref(val),
+			 DLR_PLAYER_PROP_CAN_PREVIOUS, g_variant_ref(val),
 			 changed_props_vb);
 	prv_change_props(device->props.player_props,
-			 DLR_INTERFACE_PROP_CAN_CONTROL, g_variant_ref(val),
+			 DLR_PLAYER_PROP_CAN_CONTROL, g_variant_ref(val),
 			 changed_props_vb);
 }
 
@@ -1373,7 +1651,7 @@ static void prv_add_reltime(dlr_device_t *device,
 
 	val = g_variant_ref_sink(g_variant_new_int64(pos));
 	prv_change_props(device->props.player_props,
-			 DLR_INTERFACE_PROP_POSITION, val,
+			 DLR_PLAYER_PROP_POSITION, val,
 			 changed_props_vb);
 }
 
@@ -1386,7 +1664,7 @@ static void prv_add_relcount(dlr_device_t *device,
 
 	val = g_variant_ref_sink(g_variant_new_uint64(count));
 	prv_change_props(device->props.player_props,
-			 DLR_INTERFACE_PROP_BYTE_POSITION, val,
+			 DLR_PLAYER_PROP_BYTE_POSITION, val,
 			 changed_props_vb);
 }
 
@@ -1473,33 +1751,19 @@ static void prv_found_item(GUPnPDIDLLiteParser *parser,
 	}
 }
 
-static void prv_add_track_meta_data(dlr_device_t *device,
-				    const gchar *metadata,
-				    const gchar *duration,
-				    const gchar *uri,
-				    GVariantBuilder *changed_props_vb)
+static GVariant *prv_parse_meta_data(const gchar *metadata)
 {
 	gchar *didl = g_strdup_printf("<DIDL-Lite>%s</DIDL-Lite>", metadata);
 	GUPnPDIDLLiteParser *parser = NULL;
 	GVariantBuilder *vb;
 	GError *upnp_error = NULL;
-	GVariant *val;
+	GVariant *items = NULL;
 	gint error_code;
 
 	parser = gupnp_didl_lite_parser_new();
 
 	vb = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
 
-	if (duration) {
-		val = g_variant_new_int64(prv_duration_to_int64(duration));
-		g_variant_builder_add(vb, "{sv}", "mpris:length", val);
-	}
-
-	if (uri) {
-		val = g_variant_new_string(uri);
-		g_variant_builder_add(vb, "{sv}", "xesam:url", val);
-	}
-
 	g_signal_connect(parser, "object-available" ,
 			 G_CALLBACK(prv_found_item), vb);
 
@@ -1510,10 +1774,7 @@ static void prv_add_track_meta_data(dlr_device_t *device,
 			goto on_error;
 	}
 
-	prv_change_props(device->props.player_props,
-			 DLR_INTERFACE_PROP_METADATA,
-			 g_variant_ref_sink(g_variant_builder_end(vb)),
-			 changed_props_vb);
+	items = g_variant_ref_sink(g_variant_builder_end(vb));
 
 on_error:
 
@@ -1522,6 +1783,92 @@ on_error:
 
 	g_variant_builder_unref(vb);
 	g_free(didl);
+
+	return items;
+}
+
+static void prv_update_meta_data(dlr_device_t *device,
+				 GVariantBuilder *changed_props_vb)
+{
+	dlr_device_meta_data_t *md = &device->meta_data;
+	GVariantBuilder *vb;
+	GVariantIter iter;
+	GVariant *items;
+	GVariant *val;
+	const gchar *key;
+	guint hash;
+
+	if (!md->pending)
+		goto on_exit;
+
+	md->pending = FALSE;
+	hash = g_str_hash(md->pending_didl);
+
+	if (!md->items || hash != md->hash ||
+	    strcmp(md->pending_didl, md->didl)) {
+		items = prv_parse_meta_data(md->pending_didl);
+		if (!items)
+			goto on_exit;
+
+		if (md->items)
+			g_variant_unref(md->items);
+		md->items = items;
+		md->hash = hash;
+		g_free(md->didl);
+		md->didl = md->pending_didl;
+		md->pending_didl = NULL;
+	}
+
+	vb = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
+
+	if (md->duration) {
+		val = g_variant_new_int64(prv_duration_to_int64(md->duration));
+		g_variant_builder_add(vb, "{sv}", "mpris:length", val);
+	}
+
+	if (md->uri) {
+		val = g_variant_new_string(md->uri);
+		g_variant_builder_add(vb, "{sv}", "xesam:url", val);
+	}
+
+	g_variant_iter_init(&iter, md->items);
+	while (g_variant_iter_next(&iter, "{&sv}", &key, &val)) {
+		g_variant_builder_add(vb, "{sv}", key, val);
+		g_variant_unref(val);
+	}
+
+	prv_change_props(device->props.player_props,
+			 DLR_PLAYER_PROP_METADATA,
+			 g_variant_ref_sink(g_variant_builder_end(vb)),
+			 changed_props_vb);
+
+	g_variant_builder_unref(vb);
+
+on_exit:
+
+	g_free(md->pending_didl);
+	md->pending_didl = NULL;
+}
+
+static void prv_add_track_meta_data(dlr_device_t *device,
+				    const gchar *metadata,
+				    const gchar *duration,
+				    const gchar *uri)
+{
+	dlr_device_meta_data_t *md = &device->meta_data;
+
+	/* The DIDL-Lite is only parsed, and only if it differs from the
+	   last one, when Metadata is next read or signalled. */
+
+	g_free(md->pending_didl);
+	md->pending_didl = g_strdup(metadata);
+	g_free(md->duration);
+	md->duration = g_strdup(duration);
+	g_free(md->uri);
+	md->uri = g_strdup(uri);
+	md->pending = TRUE;
+
+	prv_schedule_properties_changed(device);
 }
 
 static void prv_last_change_cb(GUPnPServiceProxy *proxy,
@@ -1529,46 +1876,45 @@ static void prv_last_change_cb(GUPnPServiceProxy *proxy,
 			       GValue *value,
 			       gpointer user_data)
 {
-	GUPnPLastChangeParser *parser;
 	dlr_device_t *device = user_data;
+	dlr_last_change_t *lc = device->av_last_change;
 	GVariantBuilder *changed_props_vb;
 	GVariant *changed_props;
-	gchar *meta_data = NULL;
-	gchar *actions = NULL;
-	gchar *play_speed = NULL;
-	gchar *state = NULL;
-	gchar *duration = NULL;
-	gchar *uri = NULL;
-	guint tracks_number = G_MAXUINT;
-	guint current_track = G_MAXUINT;
+	const gchar *meta_data;
+	const gchar *actions;
+	const gchar *play_speed;
+	const gchar *state;
+	const gchar *duration;
+	const gchar *uri;
+	guint tracks_number;
+	guint current_track;
 	GVariant *val;
 
-	parser = gupnp_last_change_parser_new();
-
-	if (!gupnp_last_change_parser_parse_last_change(
-			parser, 0,
-			g_value_get_string(value),
-			NULL,
-			"CurrentTrackMetaData", G_TYPE_STRING, &meta_data,
-			"CurrentTransportActions", G_TYPE_STRING, &actions,
-			"TransportPlaySpeed", G_TYPE_STRING, &play_speed,
-			"TransportState", G_TYPE_STRING, &state,
-			"CurrentTrackDuration", G_TYPE_STRING, &duration,
-			"CurrentTrackURI", G_TYPE_STRING, &uri,
-			"NumberOfTracks", G_TYPE_UINT, &tracks_number,
-			"CurrentTrack", G_TYPE_UINT, &current_track,
-			NULL))
+	if (!dlr_last_change_parse(lc, g_value_get_string(value), 0))
 		goto on_error;
 
+	meta_data = dlr_last_change_get_string(lc, DLR_AV_VAR_META_DATA);
+	actions = dlr_last_change_get_string(lc, DLR_AV_VAR_ACTIONS);
+	play_speed = dlr_last_change_get_string(lc, DLR_AV_VAR_PLAY_SPEED);
+	state = dlr_last_change_get_string(lc, DLR_AV_VAR_STATE);
+	duration = dlr_last_change_get_string(lc, DLR_AV_VAR_DURATION);
+	uri = dlr_last_change_get_string(lc, DLR_AV_VAR_URI);
+
+	if (!dlr_last_change_get_uint(lc, DLR_AV_VAR_NUMBER_OF_TRACKS,
+				      &tracks_number))
+		tracks_number = G_MAXUINT;
+
+	if (!dlr_last_change_get_uint(lc, DLR_AV_VAR_CURRENT_TRACK,
+				      &current_track))
+		current_track = G_MAXUINT;
+
 	changed_props_vb = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
 
 	if (meta_data) {
 		prv_add_track_meta_data(device,
 					meta_data,
 					duration,
-					uri,
-					changed_props_vb);
-		g_free(meta_data);
+					uri);
 	} else {
 		if (duration) {
 			val = g_variant_new_int64(prv_duration_to_int64(
@@ -1591,24 +1937,19 @@ static void prv_last_change_cb(GUPnPServiceProxy *proxy,
 		}
 	}
 
-	g_free(duration);
-	g_free(uri);
-
-	if (actions) {
+	if (actions)
 		prv_add_actions(device, actions, changed_props_vb);
-		g_free(actions);
-	}
 
 	if (play_speed) {
 		val = g_variant_ref_sink(
 			g_variant_new_double(
 				prv_map_transport_speed(play_speed)));
 		prv_change_props(device->props.player_props,
-				 DLR_INTERFACE_PROP_RATE, val,
+				 DLR_PLAYER_PROP_RATE, val,
 				 changed_props_vb);
 
 		g_free(device->rate);
-		device->rate = play_speed;
+		device->rate = g_strdup(play_speed);
 	}
 
 	if (state) {
@@ -1616,22 +1957,21 @@ static void prv_last_change_cb(GUPnPServiceProxy *proxy,
 			g_variant_new_string(
 				prv_map_transport_state(state)));
 		prv_change_props(device->props.player_props,
-				 DLR_INTERFACE_PROP_PLAYBACK_STATUS, val,
+				 DLR_PLAYER_PROP_PLAYBACK_STATUS, val,
 				 changed_props_vb);
-		g_free(state);
 	}
 
 	if (tracks_number != G_MAXUINT) {
 		val = g_variant_ref_sink(g_variant_new_uint32(tracks_number));
 		prv_change_props(device->props.player_props,
-				 DLR_INTERFACE_PROP_NUMBER_OF_TRACKS, val,
+				 DLR_PLAYER_PROP_NUMBER_OF_TRACKS, val,
 				 changed_props_vb);
 	}
 
 	if (current_track != G_MAXUINT) {
 		val = g_variant_ref_sink(g_variant_new_uint32(current_track));
 		prv_change_props(device->props.player_props,
-				 DLR_INTERFACE_PROP_CURRENT_TRACK, val,
+				 DLR_PLAYER_PROP_CURRENT_TRACK, val,
 				 changed_props_vb);
 	}
 
@@ -1645,7 +1985,7 @@ static void prv_last_change_cb(GUPnPServiceProxy *proxy,
 
 on_error:
 
-	g_object_unref(parser);
+	return;
 }
 
 static gboolean prv_process_rc_last_change(gpointer user_data)
@@ -1671,7 +2011,7 @@ static gboolean prv_process_rc_last_change(gpointer user_data)
 			(double) device->max_volume;
 		val = g_variant_ref_sink(g_variant_new_double(mpris_volume));
 		prv_change_props(device->props.player_props,
-				 DLR_INTERFACE_PROP_VOLUME, val,
+				 DLR_PLAYER_PROP_VOLUME, val,
 				 changed_props_vb);
 	}
 
@@ -1680,7 +2020,7 @@ static gboolean prv_process_rc_last_change(gpointer user_data)
 				g_variant_new_boolean(event->mute ? TRUE
 						      : FALSE));
 		prv_change_props(device->props.player_props,
-				 DLR_INTERFACE_PROP_MUTE, val,
+				 DLR_PLAYER_PROP_MUTE, val,
 				 changed_props_vb);
 	}
 
@@ -1707,23 +2047,24 @@ static void prv_rc_last_change_cb(GUPnPServiceProxy *proxy,
 			       GValue *value,
 			       gpointer user_data)
 {
-	GUPnPLastChangeParser *parser;
+	dlr_device_t *device = user_data;
+	dlr_last_change_t *lc = device->rc_last_change;
 	dlr_rc_event_t *event;
-	guint dev_volume = G_MAXUINT;
-	guint mute = G_MAXUINT;
+	guint dev_volume;
+	guint mute;
+	gboolean muted;
 	gint *key;
 
-	parser = gupnp_last_change_parser_new();
-
-	if (!gupnp_last_change_parser_parse_last_change(
-		    parser, 0,
-		    g_value_get_string(value),
-		    NULL,
-		    "Volume", G_TYPE_UINT, &dev_volume,
-		    "Mute", G_TYPE_UINT, &mute,
-		    NULL))
+	if (!dlr_last_change_parse(lc, g_value_get_string(value), 0))
 		goto on_error;
 
+	if (!dlr_last_change_get_uint(lc, DLR_RC_VAR_VOLUME, &dev_volume))
+		dev_volume = G_MAXUINT;
+
+	mute = G_MAXUINT;
+	if (dlr_last_change_get_bool(lc, DLR_RC_VAR_MUTE, &muted))
+		mute = muted;
+
 	event = g_new0(dlr_rc_event_t, 1);
 	event->dev_volume = dev_volume;
 	event->mute = mute;
@@ -1742,7 +2083,7 @@ static void prv_rc_last_change_cb(GUPnPServiceProxy *proxy,
 
 on_error:
 
-	g_object_unref(parser);
+	return;
 }
 
 static void prv_sink_change_cb(GUPnPServiceProxy *proxy,
@@ -1895,8 +2236,8 @@ static void prv_get_all_position_info_cb(GUPnPServiceProxy *proxy,
 		device_data->ut.get_all_position.expected_props--;
 
 		/* Do not fail, just remove the property */
-		g_hash_table_remove(cb_data->device->props.player_props,
-				    DLR_INTERFACE_PROP_POSITION);
+		dlr_prop_store_remove(cb_data->device->props.player_props,
+				      DLR_PLAYER_PROP_POSITION);
 	}
 
 	device_data->ut.get_all_position.rel_time = result;
@@ -1963,8 +2304,8 @@ static void prv_get_all_byte_position_info_cb(GUPnPServiceProxy *proxy,
 		device_data->ut.get_all_position.expected_props--;
 
 		/* Do not fail, just remove the property */
-		g_hash_table_remove(cb_data->device->props.player_props,
-				    DLR_INTERFACE_PROP_BYTE_POSITION);
+		dlr_prop_store_remove(cb_data->device->props.player_props,
+				      DLR_PLAYER_PROP_BYTE_POSITION);
 	}
 
 	device_data->ut.get_all_position.rel_cnt = result;
@@ -2248,7 +2589,8 @@ exit:
 	return device_alive;
 }
 
-static void prv_update_device_props(GUPnPDeviceInfo *proxy, GHashTable *props)
+static void prv_update_device_props(GUPnPDeviceInfo *proxy,
+				    dlr_prop_store_t *props)
 {
 	GVariant *val;
 	gchar *str;
@@ -2257,60 +2599,60 @@ static void prv_update_device_props(GUPnPDeviceInfo *proxy, GHashTable *props)
 
 	val = g_variant_ref_sink(g_variant_new_string(
 				gupnp_device_info_get_device_type(proxy)));
-	g_hash_table_insert(props, DLR_INTERFACE_PROP_DEVICE_TYPE, val);
+	dlr_prop_store_set(props, DLR_DEVICE_PROP_DEVICE_TYPE, val);
 
 	val = g_variant_ref_sink(g_variant_new_string(
 					gupnp_device_info_get_udn(proxy)));
-	g_hash_table_insert(props, DLR_INTERFACE_PROP_UDN, val);
+	dlr_prop_store_set(props, DLR_DEVICE_PROP_UDN, val);
 
 	str = gupnp_device_info_get_friendly_name(proxy);
 	val = g_variant_ref_sink(g_variant_new_string(str));
-	g_hash_table_insert(props, DLR_INTERFACE_PROP_FRIENDLY_NAME, val);
+	dlr_prop_store_set(props, DLR_DEVICE_PROP_FRIENDLY_NAME, val);
 	g_free(str);
 
 	str = gupnp_device_info_get_icon_url(proxy, NULL, -1, -1, -1, FALSE,
 					     NULL, NULL, NULL, NULL);
 	val = g_variant_ref_sink(g_variant_new_string(str));
-	g_hash_table_insert(props, DLR_INTERFACE_PROP_ICON_URL, val);
+	dlr_prop_store_set(props, DLR_DEVICE_PROP_ICON_URL, val);
 	g_free(str);
 
 	str = gupnp_device_info_get_manufacturer(proxy);
 	val = g_variant_ref_sink(g_variant_new_string(str));
-	g_hash_table_insert(props, DLR_INTERFACE_PROP_MANUFACTURER, val);
+	dlr_prop_store_set(props, DLR_DEVICE_PROP_MANUFACTURER, val);
 	g_free(str);
 
 	str = gupnp_device_info_get_manufacturer_url(proxy);
 	val = g_variant_ref_sink(g_variant_new_string(str));
-	g_hash_table_insert(props, DLR_INTERFACE_PROP_MANUFACTURER_URL, val);
+	dlr_prop_store_set(props, DLR_DEVICE_PROP_MANUFACTURER_URL, val);
 	g_free(str);
 
 	str = gupnp_device_info_get_model_description(proxy);
 	val = g_variant_ref_sink(g_variant_new_string(str));
-	g_hash_table_insert(props, DLR_INTERFACE_PROP_MODEL_DESCRIPTION, val);
+	dlr_prop_store_set(props, DLR_DEVICE_PROP_MODEL_DESCRIPTION, val);
 	g_free(str);
 
 	str = gupnp_device_info_get_model_name(proxy);
 	val = g_variant_ref_sink(g_variant_new_string(str));
-	g_hash_table_insert(props, DLR_INTERFACE_PROP_MODEL_NAME, val);
+	dlr_prop_store_set(props, DLR_DEVICE_PROP_MODEL_NAME, val);
 	g_free(str);
 
 	str = gupnp_device_info_get_model_number(proxy);
 	val = g_variant_ref_sink(g_variant_new_string(str));
-	g_hash_table_insert(props, DLR_INTERFACE_PROP_MODEL_NUMBER, val);
+	dlr_prop_store_set(props, DLR_DEVICE_PROP_MODEL_NUMBER, val);
 	g_free(str);
 
 	str = gupnp_device_info_get_serial_number(proxy);
 	val = g_variant_ref_sink(g_variant_new_string(str));
-	g_hash_table_insert(props, DLR_INTERFACE_PROP_SERIAL_NUMBER, val);
+	dlr_prop_store_set(props, DLR_DEVICE_PROP_SERIAL_NUMBER, val);
 	g_free(str);
 
 	str = gupnp_device_info_get_presentation_url(proxy);
 	val = g_variant_ref_sink(g_variant_new_string(str));
-	g_hash_table_insert(props, DLR_INTERFACE_PROP_PRESENTATION_URL, val);
+	dlr_prop_store_set(props, DLR_DEVICE_PROP_PRESENTATION_URL, val);
 	g_free(str);
 }
 
-static void prv_add_player_speed_props(GHashTable *player_props,
+static void prv_add_player_speed_props(dlr_prop_store_t *player_props,
 				       double min_rate, double max_rate,
 				       GVariant *mpris_transport_play_speeds,
 				       GVariantBuilder *changed_props_vb)
@@ -2320,21 +2662,21 @@ static void prv_add_player_speed_props(GHashTable *player_props,
 	if (min_rate != 0) {
 		val = g_variant_ref_sink(g_variant_new_double(min_rate));
 		prv_change_props(player_props,
-				 DLR_INTERFACE_PROP_MINIMUM_RATE,
+				 DLR_PLAYER_PROP_MINIMUM_RATE,
 				 val, changed_props_vb);
 	}
 
 	if (max_rate != 0) {
 		val = g_variant_ref_sink(g_variant_new_double(max_rate));
 		prv_change_props(player_props,
-				 DLR_INTERFACE_PROP_MAXIMUM_RATE,
+				 DLR_PLAYER_PROP_MAXIMUM_RATE,
 				 val, changed_props_vb);
 	}
 
 	if (mpris_transport_play_speeds != NULL) {
 		val = g_variant_ref_sink(mpris_transport_play_speeds);
 		prv_change_props(player_props,
-				 DLR_INTERFACE_PROP_TRANSPORT_PLAY_SPEEDS,
+				 DLR_PLAYER_PROP_TRANSPORT_PLAY_SPEEDS,
 				 val, changed_props_vb);
 	}
 }
@@ -2353,28 +2695,28 @@ static gboolean prv_props_update(dlr_device_t *device, dlr_task_t *task)
 	context = dlr_device_get_context(device);
 
 	val = g_variant_ref_sink(g_variant_new_boolean(FALSE));
-	g_hash_table_insert(props->root_props, DLR_INTERFACE_PROP_CAN_QUIT,
-			    val);
+	dlr_prop_store_set(props->root_props, DLR_ROOT_PROP_CAN_QUIT,
+			   val);
 
-	g_hash_table_insert(props->root_props, DLR_INTERFACE_PROP_CAN_RAISE,
-			    g_variant_ref(val));
+	dlr_prop_store_set(props->root_props, DLR_ROOT_PROP_CAN_RAISE,
+			   g_variant_ref(val));
 
-	g_hash_table_insert(props->root_props,
-			    DLR_INTERFACE_PROP_CAN_SET_FULLSCREEN,
-			    g_variant_ref(val));
+	dlr_prop_store_set(props->root_props,
+			   DLR_ROOT_PROP_CAN_SET_FULLSCREEN,
+			   g_variant_ref(val));
 
-	g_hash_table_insert(props->root_props,
-			    DLR_INTERFACE_PROP_HAS_TRACK_LIST,
-			    g_variant_ref(val));
+	dlr_prop_store_set(props->root_props,
+			   DLR_ROOT_PROP_HAS_TRACK_LIST,
+			   g_variant_ref(val));
 
 	info = (GUPnPDeviceInfo *)context->device_proxy;
 
 	prv_update_device_props(info, props->device_props);
 
-	val = g_hash_table_lookup(props->device_props,
-			    DLR_INTERFACE_PROP_FRIENDLY_NAME);
-	g_hash_table_insert(props->root_props, DLR_INTERFACE_PROP_IDENTITY,
-			    g_variant_ref(val));
+	val = dlr_prop_store_get(props->device_props,
+				 DLR_DEVICE_PROP_FRIENDLY_NAME);
+	dlr_prop_store_set(props->root_props, DLR_ROOT_PROP_IDENTITY,
+			   g_variant_ref(val));
 
 	service_proxies = &context->service_proxies;
 
@@ -2502,8 +2844,8 @@ static GVariant *prv_get_rate_value_from_double(GVariant *params,
 	int i;
 
 	if (dev->dlna_transport_play_speeds != NULL) {
-		tps = g_hash_table_lookup(dev->props.player_props,
-				DLR_INTERFACE_PROP_TRANSPORT_PLAY_SPEEDS);
+		tps = dlr_prop_store_get(dev->props.player_props,
+				DLR_PLAYER_PROP_TRANSPORT_PLAY_SPEEDS);
 
 		tp_speeds = dev->dlna_transport_play_speeds;
 	} else {
@@ -2583,7 +2925,7 @@ static void prv_set_rate(GVariant *params, dlr_async_task_t *cb_data)
 	changed_props_vb = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
 
 	prv_change_props(cb_data->device->props.player_props,
-			 DLR_INTERFACE_PROP_RATE, val, changed_props_vb);
+			 DLR_PLAYER_PROP_RATE, val, changed_props_vb);
 
 	changed_props = g_variant_ref_sink(
 				g_variant_builder_end(changed_props_vb));
@@ -2621,8 +2963,8 @@ void dlr_device_set_prop(dlr_device_t *device, dlr_task_t *task,
 
 		prv_set_rate(set_prop->params, cb_data);
 
-		state = g_hash_table_lookup(device->props.player_props,
-									DLR_INTERFACE_PROP_PLAYBACK_STATUS);
+		state = dlr_prop_store_get(device->props.player_props,
+									DLR_PLAYER_PROP_PLAYBACK_STATUS);
 		if (!state || strcmp(g_variant_get_string(state, NULL), "Playing")) {
 			goto exit;
 		}
@@ -2677,7 +3019,42 @@ static void prv_free_get_all_position_data(gpointer data)
 	}
 }
 
+static void prv_get_host_stats(dlr_async_task_t *cb_data,
+			       dlr_host_service_t *host_service,
+			       const gchar *prop_name)
+{
+	dlr_device_context_t *context;
+	GVariant *stats;
+	GVariant *res;
+
+	/* The push host counters are those of the server for the network
+	   interface through which this renderer is reached, so they are
+	   shared by all the renderers on that interface. */
+
+	context = dlr_device_get_context(cb_data->device);
+	stats = g_variant_ref_sink(
+			dlr_host_service_get_stats(host_service,
+						   context->ip_address));
+
+	if (!prop_name) {
+		cb_data->task.result = g_variant_ref(stats);
+	} else {
+		res = g_variant_lookup_value(stats, prop_name, NULL);
+
+		if (res)
+			cb_data->task.result = res;
+		else
+			cb_data->error = g_error_new(
+					DLEYNA_SERVER_ERROR,
+					DLEYNA_ERROR_UNKNOWN_PROPERTY,
+					"Property not defined for object");
+	}
+
+	g_variant_unref(stats);
+}
+
 void dlr_device_get_prop(dlr_device_t *device, dlr_task_t *task,
+			 dlr_host_service_t *host_service,
 			 dlr_upnp_task_complete_t cb)
 {
 	dlr_async_task_t *cb_data = (dlr_async_task_t *)task;
@@ -2688,11 +3065,16 @@ void dlr_device_get_prop(dlr_device_t *device, dlr_task_t *task,
 	cb_data->cb = cb;
 	cb_data->device = device;
 
-	/* Need to check to see if the property is DLR_INTERFACE_PROP_POSITION.
-	   If it is we need to call GetPositionInfo.  This value is not evented.
-	   Otherwise we can just update the value straight away. */
+	/* Push host properties are counters kept by the host service.
+	   Otherwise, need to check to see if the property is
+	   DLR_INTERFACE_PROP_POSITION.  If it is we need to call
+	   GetPositionInfo.  This value is not evented.  Otherwise we can
+	   just update the value straight away. */
 
-	if ((!strcmp(get_prop->interface_name, DLR_INTERFACE_PLAYER) ||
+	if (!strcmp(get_prop->interface_name, DLEYNA_INTERFACE_PUSH_HOST)) {
+		prv_get_host_stats(cb_data, host_service, get_prop->prop_name);
+		(void) g_idle_add(dlr_async_task_complete, cb_data);
+	} else if ((!strcmp(get_prop->interface_name, DLR_INTERFACE_PLAYER) ||
 	     !strcmp(get_prop->interface_name, "")) &&
 	    (!strcmp(task->ut.get_prop.prop_name,
 			DLR_INTERFACE_PROP_POSITION) ||
@@ -2727,6 +3109,7 @@ void dlr_device_get_prop(dlr_device_t *device, dlr_task_t *task,
 }
 
 void dlr_device_get_all_props(dlr_device_t *device, dlr_task_t *task,
+			      dlr_host_service_t *host_service,
 			      dlr_upnp_task_complete_t cb)
 {
 	dlr_async_task_t *cb_data = (dlr_async_task_t *)task;
@@ -2736,7 +3119,10 @@ void dlr_device_get_all_props(dlr_device_t *device, dlr_task_t *task,
 	cb_data->cb = cb;
 	cb_data->device = device;
 
-	if (!device->props.synced && !prv_props_update(device, task)) {
+	if (!strcmp(get_props->interface_name, DLEYNA_INTERFACE_PUSH_HOST)) {
+		prv_get_host_stats(cb_data, host_service, NULL);
+		(void) g_idle_add(dlr_async_task_complete, cb_data);
+	} else if (!device->props.synced && !prv_props_update(device, task)) {
 		cb_data->error = g_error_new(
 			DLEYNA_SERVER_ERROR,
 			DLEYNA_ERROR_OPERATION_FAILED,
@@ -2807,8 +3193,8 @@ void dlr_device_play_pause(dlr_device_t *device, dlr_task_t *task,
 {
 	GVariant *state;
 
-	state = g_hash_table_lookup(device->props.player_props,
-				    DLR_INTERFACE_PROP_PLAYBACK_STATUS);
+	state = dlr_prop_store_get(device->props.player_props,
+				   DLR_PLAYER_PROP_PLAYBACK_STATUS);
 
 	if (state && !strcmp(g_variant_get_string(state, NULL), "Playing"))
 		dlr_device_pause(device, task, cb);
@@ -2887,19 +3273,19 @@ static void prv_reset_transport_speed_props(dlr_device_t *device)
 		device->dlna_transport_play_speeds = NULL;
 	}
 
-	val = g_hash_table_lookup(device->props.player_props,
-				  DLR_INTERFACE_PROP_TRANSPORT_PLAY_SPEEDS);
+	val = dlr_prop_store_get(device->props.player_props,
+				 DLR_PLAYER_PROP_TRANSPORT_PLAY_SPEEDS);
 	if (!val ||
 	    !g_variant_equal(val, device->mpris_transport_play_speeds)) {
 		min_rate = 0;
-		val = g_hash_table_lookup(device->props.player_props,
-					  DLR_INTERFACE_PROP_MINIMUM_RATE);
+		val = dlr_prop_store_get(device->props.player_props,
+					 DLR_PLAYER_PROP_MINIMUM_RATE);
 		if (!val || (g_variant_get_double(val) != device->min_rate))
 			min_rate = device->min_rate;
 
 		max_rate = 0;
-		val = g_hash_table_lookup(device->props.player_props,
-					  DLR_INTERFACE_PROP_MAXIMUM_RATE);
+		val = dlr_prop_store_get(device->props.player_props,
+					 DLR_PLAYER_PROP_MAXIMUM_RATE);
 		if (!val || (g_variant_get_double(val) != device->max_rate))
 			max_rate = device->max_rate;
 
@@ -2918,7 +3304,7 @@ static void prv_reset_transport_speed_props(dlr_device_t *device)
 		val = g_variant_ref_sink(g_variant_new_double(
 					prv_map_transport_speed(device->rate)));
 		prv_change_props(device->props.player_props,
-				 DLR_INTERFACE_PROP_RATE, val,
+				 DLR_PLAYER_PROP_RATE, val,
 				 changed_props_vb);
 
 		props_changed = TRUE;
@@ -2993,6 +3379,7 @@ on_exit:
 }
 
 void dlr_device_open_uri(dlr_device_t *device, dlr_task_t *task,
+			 dlr_host_service_t *host_service,
 			 dlr_upnp_task_complete_t cb)
 {
 	dlr_device_context_t *context;
@@ -3004,6 +3391,13 @@ void dlr_device_open_uri(dlr_device_t *device, dlr_task_t *task,
 	DLEYNA_LOG_INFO("METADATA: %s", metadata ? metadata : "Not provided");
 	DLEYNA_LOG_INFO("ACTION: %s", open_uri_data->operation);
 
+	/* The renderer fetches the next URI before the current one ends.
+	   If we host it, its start is read into the page cache now so
+	   that the transition does not have to wait for the disk. */
+
+	if (task->type == DLR_TASK_OPEN_NEXT_URI)
+		dlr_host_service_prefetch(host_service, open_uri_data->uri);
+
 	context = dlr_device_get_context(device);
 	cb_data->cb = cb;
 	cb_data->device = device;
@@ -3206,6 +3600,146 @@ void dlr_device_goto_track(dlr_device_t *device, dlr_task_t *task,
 	prv_device_set_position(device, task, "TRACK_NR", cb);
 }
 
+static void prv_host_uri_cb(const gchar *url, const GError *error,
+			    gpointer user_data)
+{
+	dlr_async_task_t *cb_data = user_data;
+
+	if (url)
+		cb_data->task.result = g_variant_ref_sink(
+						g_variant_new_string(url));
+	else
+		cb_data->error = g_error_copy(error);
+
+	(void) g_idle_add(dlr_async_task_complete, cb_data);
+}
+
+static void prv_host_uris_free(gpointer data)
+{
+	prv_host_uris_t *batch = data;
+
+	if (batch) {
+		g_strfreev(batch->urls);
+		g_variant_builder_unref(batch->errors);
+		g_free(batch->items);
+		g_free(batch);
+	}
+}
+
+static void prv_host_uris_complete(prv_host_uris_t *batch)
+{
+	dlr_async_task_t *cb_data = batch->task;
+	GVariantBuilder vb;
+	GVariant *out_p[2];
+	guint count = g_strv_length(cb_data->task.ut.host_uris.uris);
+	guint i;
+
+	if (!cb_data->error) {
+		g_variant_builder_init(&vb, G_VARIANT_TYPE("as"));
+
+		for (i = 0; i < count; ++i)
+			g_variant_builder_add(&vb, "s", batch->urls[i] ?
+					      batch->urls[i] : "");
+
+		out_p[0] = g_variant_builder_end(&vb);
+		out_p[1] = g_variant_builder_end(batch->errors);
+		cb_data->task.result = g_variant_ref_sink(
+						g_variant_new_tuple(out_p, 2));
+	}
+
+	(void) g_idle_add(dlr_async_task_complete, cb_data);
+}
+
+static void prv_host_uris_cb(const gchar *url, const GError *error,
+			     gpointer user_data)
+{
+	prv_host_uris_item_t *item = user_data;
+	prv_host_uris_t *batch = item->batch;
+	dlr_async_task_t *cb_data = batch->task;
+	const gchar *path = cb_data->task.ut.host_uris.uris[item->index];
+
+	/* A failure to host one file is reported alongside the URLs of
+	   the others.  Only cancellation fails the whole batch. */
+
+	if (url) {
+		batch->urls[item->index] = g_strdup(url);
+	} else if (g_error_matches(error, DLEYNA_SERVER_ERROR,
+				   DLEYNA_ERROR_CANCELLED)) {
+		if (!cb_data->error)
+			cb_data->error = g_error_copy(error);
+	} else {
+		DLEYNA_LOG_WARNING("Unable to host %s: %s", path,
+				   error->message);
+
+		g_variant_builder_add(batch->errors, "{ss}", path,
+				      error->message);
+	}
+
+	if (--batch->pending == 0)
+		prv_host_uris_complete(batch);
+}
+
+static gboolean prv_can_open_local_files(dlr_device_t *device,
+					 dlr_device_context_t *context)
+{
+	/* A renderer running on this machine that accepts file URIs can
+	   open the file itself, which saves copying it through the web
+	   server and the loopback interface. */
+
+	return device->can_play_local_files && prv_is_local_context(context);
+}
+
+static void prv_host_uris(dlr_device_t *device, dlr_async_task_t *cb_data,
+			  dlr_host_service_t *host_service)
+{
+	dlr_device_context_t *context;
+	dlr_task_host_uris_t *host_uris = &cb_data->task.ut.host_uris;
+	prv_host_uris_t *batch;
+	gboolean local;
+	guint count;
+	guint i;
+
+	count = g_strv_length(host_uris->uris);
+
+	batch = g_new0(prv_host_uris_t, 1);
+	batch->task = cb_data;
+	batch->urls = g_new0(gchar *, count + 1);
+	batch->errors = g_variant_builder_new(G_VARIANT_TYPE("a{ss}"));
+	batch->items = g_new0(prv_host_uris_item_t, count);
+
+	cb_data->private = batch;
+	cb_data->free_private = prv_host_uris_free;
+
+	if (count == 0) {
+		prv_host_uris_complete(batch);
+		goto on_exit;
+	}
+
+	/* All files are handed to the host service up front so that those
+	   which need probing are probed concurrently.  The count is set
+	   first as results may be delivered before we return. */
+
+	batch->pending = count;
+	context = dlr_device_get_context(device);
+	local = prv_can_open_local_files(device, context);
+
+	for (i = 0; i < count; ++i) {
+		batch->items[i].batch = batch;
+		batch->items[i].index = i;
+
+		dlr_host_service_add(host_service, context->ip_address,
+				     host_uris->client, host_uris->uris[i],
+				     FALSE, local, device->image_profile,
+				     cb_data->cancellable,
+				     prv_host_uris_cb,
+				     &batch->items[i]);
+	}
+
+on_exit:
+
+	return;
+}
+
 void dlr_device_host_uri(dlr_device_t *device, dlr_task_t *task,
 			 dlr_host_service_t *host_service,
 			 dlr_upnp_task_complete_t cb)
@@ -3213,25 +3747,33 @@ void dlr_device_host_uri(dlr_device_t *device, dlr_task_t *task,
 	dlr_device_context_t *context;
 	dlr_async_task_t *cb_data = (dlr_async_task_t *)task;
 	dlr_task_host_uri_t *host_uri = &task->ut.host_uri;
-	gchar *url;
-	GError *error = NULL;
-
-	context = dlr_device_get_context(device);
-	url = dlr_host_service_add(host_service, context->ip_address,
-				   host_uri->client, host_uri->uri,
-				   &error);
+	gboolean live;
+	gboolean local;
 
 	cb_data->cb = cb;
 	cb_data->device = device;
-	if (url) {
-		cb_data->task.result = g_variant_ref_sink(
-						g_variant_new_string(url));
-		g_free(url);
-	} else {
-		cb_data->error  = error;
+
+	if (task->type == DLR_TASK_HOST_URIS) {
+		prv_host_uris(device, cb_data, host_service);
+		goto on_exit;
 	}
 
-	(void) g_idle_add(dlr_async_task_complete, cb_data);
+	context = dlr_device_get_context(device);
+
+	/* Live files are always served, as it is the web server that
+	   follows them as they grow. */
+
+	live = task->type == DLR_TASK_HOST_LIVE_URI;
+	local = !live && prv_can_open_local_files(device, context);
+
+	dlr_host_service_add(host_service, context->ip_address,
+			     host_uri->client, host_uri->uri, live, local,
+			     device->image_profile, cb_data->cancellable,
+			     prv_host_uri_cb, cb_data);
+
+on_exit:
+
+	return;
 }
 
 void dlr_device_remove_uri(dlr_device_t *device, dlr_task_t *task,
@@ -3247,7 +3789,8 @@ void dlr_device_remove_uri(dlr_device_t *device, dlr_task_t *task,
 	cb_data->device = device;
 
 	if (!dlr_host_service_remove(host_service, context->ip_address,
-				     host_uri->client, host_uri->uri)) {
+				     host_uri->client, host_uri->uri,
+				     device->image_profile)) {
 		cb_data->error = g_error_new(DLEYNA_SERVER_ERROR,
 					     DLEYNA_ERROR_OBJECT_NOT_FOUND,
 					     "File not hosted for specified device");
@@ -32,6 +32,8 @@
 #include <libdleyna/core/connector.h>
 
 #include "host-service.h"
+#include "last-change.h"
+#include "prop-store.h"
 #include "server.h"
 #include "upnp.h"
 
@@ -58,9 +60,9 @@ struct dlr_device_context_t_ {
 
 typedef struct dlr_props_t_ dlr_props_t;
 struct dlr_props_t_ {
-	GHashTable *root_props;
-	GHashTable *player_props;
-	GHashTable *device_props;
+	dlr_prop_store_t *root_props;
+	dlr_prop_store_t *player_props;
+	dlr_prop_store_t *device_props;
 	gboolean synced;
 };
 
@@ -71,6 +73,21 @@ struct dlr_device_icon_t_ {
 	gsize size;
 };
 
+/* CurrentTrackMetaData is only parsed when Metadata is read or signalled.
+   didl and items memoize the last parse, as renderers often repeat the
+   same metadata in consecutive events. */
+
+typedef struct dlr_device_meta_data_t_ dlr_device_meta_data_t;
+struct dlr_device_meta_data_t_ {
+	guint hash;
+	gchar *didl;
+	GVariant *items;
+	gboolean pending;
+	gchar *pending_didl;
+	gchar *duration;
+	gchar *uri;
+};
+
 struct dlr_device_t_ {
 	dleyna_connector_id_t connection;
 	guint ids[DLR_INTERFACE_INFO_MAX];
@@ -86,9 +103,17 @@ struct dlr_device_t_ {
 	double min_rate;
 	double max_rate;
 	gboolean can_get_byte_position;
+	gboolean can_play_local_files;
+	const dlr_image_profile_t *image_profile;
 	guint construct_step;
 	dlr_device_icon_t icon;
 	GHashTable *rc_event_handlers;
+	dlr_last_change_t *av_last_change;
+	dlr_last_change_t *rc_last_change;
+	guint changes_delay;
+	GPtrArray *pending_changes;
+	guint changes_id;
+	dlr_device_meta_data_t meta_data;
 };
 
 void dlr_device_construct(
@@ -104,7 +129,8 @@ dlr_device_t *dlr_device_new(
 			const gchar *ip_address,
 			const char *udn,
 			const dleyna_connector_dispatch_cb_t *dispatch_table,
-			const dleyna_task_queue_key_t *queue_id);
+			const dleyna_task_queue_key_t *queue_id,
+			guint changes_delay);
 
 void dlr_device_delete(void *device);
 
@@ -125,9 +151,11 @@ void dlr_device_set_prop(dlr_device_t *device, dlr_task_t *task,
 			 dlr_upnp_task_complete_t cb);
 
 void dlr_device_get_prop(dlr_device_t *device, dlr_task_t *task,
+			dlr_host_service_t *host_service,
 			dlr_upnp_task_complete_t cb);
 
 void dlr_device_get_all_props(dlr_device_t *device, dlr_task_t *task,
+			      dlr_host_service_t *host_service,
 			      dlr_upnp_task_complete_t cb);
 
 void dlr_device_play(dlr_device_t *device, dlr_task_t *task,
@@ -149,6 +177,7 @@ void dlr_device_previous(dlr_device_t *device, dlr_task_t *task,
 			 dlr_upnp_task_complete_t cb);
 
 void dlr_device_open_uri(dlr_device_t *device, dlr_task_t *task,
+			 dlr_host_service_t *host_service,
 			 dlr_upnp_task_complete_t cb);
 
 void dlr_device_seek(dlr_device_t *device, dlr_task_t *task,
@@ -24,8 +24,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
 #include <libsoup/soup.h>
+#include <gio/gio.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 
 #include <libgupnp-av/gupnp-dlna.h>
 #include <libgupnp-dlna/gupnp-dlna-profile.h>
@@ -34,34 +45,207 @@
 #include <libdleyna/core/error.h>
 #include <libdleyna/core/log.h>
 
+#include "access-log.h"
 #include "host-service.h"
+#include "image-scaler.h"
+#include "profile-cache.h"
+#include "prop-defs.h"
+#include "renderer-settings.h"
+#include "seek-index.h"
+#include "shaper.h"
 
 #define DLR_HOST_SERVICE_ROOT "/dleynarenderer"
+#define DLR_HOST_SERVICE_MAX_PROBES 4
+#define DLR_HOST_SERVICE_PROFILE_CACHE_SIZE 2048
+#define DLR_HOST_SERVICE_MAX_READERS 4
+#define DLR_HOST_SERVICE_CHUNK_SIZE (256 * 1024)
+#define DLR_HOST_SERVICE_STREAM_AHEAD 4
+#define DLR_HOST_SERVICE_READAHEAD_SIZE (8 * 1024 * 1024)
+
+/* gupnp-dlna does not make any promise about guessing profiles from
+   several threads at once, so each probe thread has a guesser of its own,
+   released when the thread exits. */
+
+static GPrivate g_guesser = G_PRIVATE_INIT(g_object_unref);
+
+typedef struct dlr_host_server_t_ dlr_host_server_t;
 
 typedef struct dlr_host_file_t_ dlr_host_file_t;
 struct dlr_host_file_t_ {
+	guint ref_count;
+	dlr_host_service_t *host_service;
+	dlr_host_server_t *server;
+	const gchar *key;
 	unsigned int id;
-	GPtrArray *clients;
+	GHashTable *clients;
 	gchar *mime_type;
 	GMappedFile *mapped_file;
-	unsigned int mapped_count;
+	GList *mapped_link;
+	goffset size;
+	gboolean streamed;
+	gboolean live;
+	gchar *etag;
+	time_t mtime;
+	dlr_seek_index_t *seek_index;
 	gchar *path;
 	gchar *dlna_header;
+	gchar *source;
+	const dlr_image_profile_t *image_fit;
+};
+
+typedef struct dlr_host_stats_t_ dlr_host_stats_t;
+struct dlr_host_stats_t_ {
+	guint64 requests;
+	guint64 bytes_sent;
+	guint active;
+	guint64 completed;
+	guint64 aborted;
+	gint64 transfer_time;
 };
 
-typedef struct dlr_host_server_t_ dlr_host_server_t;
 struct dlr_host_server_t_ {
+	dlr_host_service_t *host_service;
+	gchar *device_if;
 	GHashTable *files;
+	GHashTable *urls;
 	SoupServer *soup_server;
+	dlr_shaper_t *shaper;
+	GHashTable *transfers;
+	dlr_host_stats_t stats;
 	unsigned int counter;
 };
 
+/* Records a single request, from the time it is received until its
+   response has been sent or abandoned. */
+
+typedef struct dlr_host_transfer_t_ dlr_host_transfer_t;
+struct dlr_host_transfer_t_ {
+	dlr_host_service_t *host_service;
+	dlr_host_server_t *server;
+	gchar *client;
+	gchar *path;
+	gchar *date;
+	int id;
+	goffset start;
+	goffset end;
+	guint64 bytes;
+	gint64 started;
+	gboolean counted;
+	gboolean wrote_body;
+	const gchar *error;
+};
+
+typedef struct dlr_host_probe_t_ dlr_host_probe_t;
+struct dlr_host_probe_t_ {
+	dlr_host_service_t *host_service;
+	gchar *key;
+	gchar *file;
+	const dlr_image_profile_t *image_profile;
+	gchar *variant;
+	gchar *mime_type;
+	gchar *dlna_header;
+	dlr_seek_index_t *seek_index;
+	GError *error;
+	dlr_profile_cache_stamp_t stamp;
+	gboolean stamped;
+	gboolean cached;
+	gboolean streamed;
+	gboolean live;
+	gboolean local;
+	gboolean regular;
+	goffset read_ahead;
+	GPtrArray *waiters;
+	GSource *source;
+};
+
+typedef struct dlr_host_waiter_t_ dlr_host_waiter_t;
+struct dlr_host_waiter_t_ {
+	dlr_host_probe_t *probe;
+	gchar *device_if;
+	gchar *client;
+	GCancellable *cancellable;
+	gulong cancel_id;
+	gboolean live;
+	const dlr_image_profile_t *image_profile;
+	dlr_host_service_add_cb_t cb;
+	gpointer user_data;
+};
+
+/* Everything a client has hosted, so that it can be released without
+   visiting the files of other clients when the client goes away. */
+
+typedef struct dlr_host_client_t_ dlr_host_client_t;
+struct dlr_host_client_t_ {
+	GHashTable *files;
+	GHashTable *local_files;
+};
+
+typedef struct dlr_host_stream_t_ dlr_host_stream_t;
+struct dlr_host_stream_t_ {
+	dlr_host_service_t *host_service;
+	SoupServer *soup_server;
+	SoupMessage *msg;
+	gchar *file_name;
+	int fd;
+	GMappedFile *mapped_file;
+	goffset offset;
+	goffset end;
+	guint queued;
+	gboolean reading;
+	gboolean finished;
+	gboolean complete;
+	gchar *buffer;
+	gssize length;
+	int read_errno;
+	GSource *source;
+	gboolean live;
+	gboolean waiting;
+	gboolean modified;
+	gboolean writer_closed;
+	gboolean close_notified;
+	guint idle;
+	int watch_fd;
+	GSource *watch_source;
+	GSource *wait_source;
+	dlr_shaper_flow_t *flow;
+	gsize granted;
+	gboolean throttled;
+	dlr_host_transfer_t *transfer;
+};
+
 struct dlr_host_service_t_ {
 	GHashTable *servers;
+	GHashTable *probes;
+	GThreadPool *probe_pool;
+	dlr_profile_cache_t *profiles;
+	GQueue mapped_files;
+	gsize mapped_bytes;
+	gsize map_budget;
+	guint64 map_hits;
+	guint64 map_misses;
+	GThreadPool *read_pool;
+	GHashTable *streams;
+	goffset stream_threshold;
+	guint live_timeout;
+	guint max_rate;
+	guint client_max_rate;
+	guint connection_max_rate;
+	dlr_access_log_t *access_log;
+	gboolean local_file_uris;
+	GHashTable *local_files;
+	GHashTable *clients;
+	gboolean scale_images;
+	gchar *image_cache_dir;
+	GMutex lock;
+	GHashTable *retiring;
+	GMainContext *context;
+	GMainLoop *loop;
+	GThread *thread;
 	guint port;
 };
 
-static void prv_compute_mime_and_dlna_header(const gchar *filename,
+static void prv_compute_mime_and_dlna_header(GUPnPDLNAProfileGuesser *guesser,
+					     const gchar *filename,
 					     gchar **mime_type,
 					     gchar **dlna_header,
 					     GError **error)
@@ -69,9 +253,6 @@ static void prv_compute_mime_and_dlna_header(const gchar *filename,
 	gchar *uri;
 	GString *header;
 	GUPnPDLNAProfile *profile;
-	GUPnPDLNAProfileGuesser *guesser;
-	gboolean relaxed_mode = TRUE;
-	gboolean extended_mode = TRUE;
 	const char *profile_name;
 	const char *dlna_mime_type;
 	GUPnPDLNAOperation operation;
@@ -87,8 +268,6 @@ static void prv_compute_mime_and_dlna_header(const gchar *filename,
 
 	header = g_string_new("");
 
-	guesser = gupnp_dlna_profile_guesser_new(relaxed_mode, extended_mode);
-
 	uri = g_filename_to_uri(filename, NULL, error);
 	if (uri == NULL) {
 		DLEYNA_LOG_WARNING("Unable to convert filename: %s", filename);
@@ -182,8 +361,6 @@ on_error:
 
 	DLEYNA_LOG_DEBUG("contentFeatures.dlna.org: %s", header->str);
 
-	g_object_unref(guesser);
-
 	g_free(uri);
 
 	if (*mime_type)
@@ -194,400 +371,2813 @@ on_error:
 	return;
 }
 
-static void prv_host_file_delete(gpointer host_file)
+static void prv_host_file_unmap(dlr_host_file_t *hf)
 {
-	dlr_host_file_t *hf = host_file;
-	unsigned int i;
-
-	if (hf) {
-		g_free(hf->path);
-		for (i = 0; i < hf->mapped_count; ++i)
-			g_mapped_file_unref(hf->mapped_file);
+	dlr_host_service_t *host_service = hf->host_service;
 
-		g_ptr_array_unref(hf->clients);
+	if (hf->mapped_file) {
+		host_service->mapped_bytes -=
+				g_mapped_file_get_length(hf->mapped_file);
+		g_queue_delete_link(&host_service->mapped_files,
+				    hf->mapped_link);
+		hf->mapped_link = NULL;
 
-		g_free(hf->mime_type);
-		g_free(hf->dlna_header);
-		g_free(hf);
+		g_mapped_file_unref(hf->mapped_file);
+		hf->mapped_file = NULL;
 	}
 }
 
-static dlr_host_file_t *prv_host_file_new(const gchar *file, unsigned int id,
-					  GError **error)
+static void prv_advise_mapping(GMappedFile *mapped_file, goffset start,
+			       goffset length, gboolean whole_file)
 {
-	dlr_host_file_t *hf = NULL;
-	gchar *extension;
-
-	if (!g_file_test(file, G_FILE_TEST_IS_REGULAR | G_FILE_TEST_EXISTS)) {
-		*error = g_error_new(DLEYNA_SERVER_ERROR,
-				     DLEYNA_ERROR_OBJECT_NOT_FOUND,
-				     "File %s does not exist or is not a regular file",
-				     file);
-		goto on_error;
-	}
-
-	hf = g_new0(dlr_host_file_t, 1);
-	hf->id = id;
-	hf->clients = g_ptr_array_new_with_free_func(g_free);
-
-	extension = strrchr(file, '.');
-	hf->path = g_strdup_printf(DLR_HOST_SERVICE_ROOT"/%d%s",
-				   hf->id, extension ? extension : "");
+#ifdef HAVE_MADVISE
+	gchar *contents = g_mapped_file_get_contents(mapped_file);
+	goffset page_size = sysconf(_SC_PAGESIZE);
+	goffset offset;
 
-	prv_compute_mime_and_dlna_header(file, &hf->mime_type, &hf->dlna_header,
-					 error);
+	if (!contents || length <= 0)
+		return;
 
-	if (*error != NULL)
-		goto on_error;
+	if (whole_file) {
+		(void) madvise(contents, g_mapped_file_get_length(mapped_file),
+			       MADV_SEQUENTIAL);
+	} else {
+		offset = start - (start % page_size);
+		(void) madvise(contents + offset, length + start - offset,
+			       MADV_WILLNEED);
+	}
+#endif
+}
 
-	return hf;
+static void prv_host_file_set_validators(dlr_host_file_t *hf,
+					 const dlr_profile_cache_stamp_t *stamp)
+{
+	/* The validators identify the version of the file being served,
+	   so that renderers fetching the same thumbnail or image again
+	   can be told that their copy is still good. */
+
+	g_free(hf->etag);
+	hf->etag = g_strdup_printf("\"%"G_GINT64_MODIFIER"x-%"
+				   G_GINT64_MODIFIER"x-%"
+				   G_GINT64_MODIFIER"x\"",
+				   stamp->inode, (guint64) stamp->size,
+				   (guint64) stamp->mtime);
+	hf->mtime = stamp->mtime;
+}
 
-on_error:
+static void prv_host_file_stamp(dlr_host_file_t *hf, const GStatBuf *buf)
+{
+	dlr_profile_cache_stamp_t stamp;
 
-	prv_host_file_delete(hf);
+	stamp.inode = buf->st_ino;
+	stamp.size = buf->st_size;
+	stamp.mtime = buf->st_mtime;
 
-	return NULL;
+	prv_host_file_set_validators(hf, &stamp);
 }
 
-static void prv_host_server_delete(gpointer host_server)
+static void prv_host_file_restamp(dlr_host_file_t *hf, const GStatBuf *buf)
 {
-	dlr_host_server_t *server = host_server;
+	gchar *etag = hf->etag;
 
-	if (server) {
-		soup_server_quit(server->soup_server);
-		g_object_unref(server->soup_server);
-		g_hash_table_unref(server->files);
-		g_free(server);
+	/* A file that has changed is mapped again when next requested */
+
+	hf->etag = NULL;
+	prv_host_file_stamp(hf, buf);
+	hf->size = buf->st_size;
+
+	if (g_strcmp0(etag, hf->etag)) {
+		prv_host_file_unmap(hf);
+		hf->image_fit = NULL;
 	}
+
+	g_free(etag);
 }
 
-static dlr_host_file_t *prv_host_server_find_file(dlr_host_server_t *hs,
-						  const gchar *url,
-						  const gchar **file_name)
+static GMappedFile *prv_host_file_map(dlr_host_file_t *hf,
+				      const gchar *file_name)
 {
-	dlr_host_file_t *retval = NULL;
-	GHashTableIter iter;
-	gpointer key;
-	gpointer value;
+	dlr_host_service_t *host_service = hf->host_service;
+	GMappedFile *mapped_file;
+	GMappedFile *retval = NULL;
+	dlr_host_file_t *lru;
+	GStatBuf buf;
+	gboolean stamped;
 
-	g_hash_table_iter_init(&iter, hs->files);
+	/* This is called without the lock, which is only taken to look
+	   up and account for the mapping, never while the file itself
+	   is being mapped. */
 
-	while (g_hash_table_iter_next(&iter, &key, &value)) {
-		if (!strcmp(((dlr_host_file_t *)value)->path, url)) {
-			retval = value;
-			*file_name = key;
-			break;
-		}
-	}
+	g_mutex_lock(&host_service->lock);
 
-	return retval;
-}
+	if (hf->mapped_file) {
+		host_service->map_hits++;
 
-static void prv_soup_message_finished_cb(SoupMessage *msg, gpointer user_data)
-{
-	dlr_host_file_t *hf = user_data;
+		g_queue_unlink(&host_service->mapped_files, hf->mapped_link);
+		g_queue_push_tail_link(&host_service->mapped_files,
+				       hf->mapped_link);
 
-	if (hf->mapped_count > 0) {
-		g_mapped_file_unref(hf->mapped_file);
-		--hf->mapped_count;
+		retval = g_mapped_file_ref(hf->mapped_file);
 
-		if (hf->mapped_count == 0)
-			hf->mapped_file = NULL;
+		goto on_exit;
 	}
-}
 
-static void prv_soup_server_cb(SoupServer *server, SoupMessage *msg,
-			       const char *path, GHashTable *query,
-			       SoupClientContext *client, gpointer user_data)
-{
-	dlr_host_file_t *hf;
-	dlr_host_server_t *hs = user_data;
-	const gchar *file_name;
-	const char *hdr;
+	host_service->map_misses++;
 
-	if ((msg->method != SOUP_METHOD_GET) &&
-	    (msg->method != SOUP_METHOD_HEAD)) {
-		soup_message_set_status(msg, SOUP_STATUS_NOT_IMPLEMENTED);
-		goto on_error;
-	}
+	g_mutex_unlock(&host_service->lock);
 
-	hf = prv_host_server_find_file(hs, path, &file_name);
+	mapped_file = g_mapped_file_new(file_name, FALSE, NULL);
 
-	if (!hf) {
-		soup_message_set_status(msg, SOUP_STATUS_NOT_FOUND);
-		goto on_error;
+	/* The file may have changed since it was last mapped */
+
+	stamped = FALSE;
+	if (mapped_file) {
+		stamped = g_stat(file_name, &buf) == 0;
+		prv_advise_mapping(mapped_file, 0, 0, TRUE);
 	}
 
-	hdr = soup_message_headers_get_one(msg->request_headers,
-					   "getContentFeatures.dlna.org");
+	g_mutex_lock(&host_service->lock);
 
-	if (hdr) {
-		if (strcmp(hdr, "1") != 0) {
-			soup_message_set_status(msg, SOUP_STATUS_BAD_REQUEST);
-			goto on_error;
-		}
+	if (!mapped_file)
+		goto on_exit;
 
-		if ((hf->dlna_header) && strlen(hf->dlna_header) > 0)
-			soup_message_headers_append(msg->response_headers,
-						    "contentFeatures.dlna.org",
-						    hf->dlna_header);
-	}
+	if (stamped)
+		prv_host_file_stamp(hf, &buf);
 
-	if (hf->mapped_file) {
-		g_mapped_file_ref(hf->mapped_file);
-		++hf->mapped_count;
-	} else {
-		hf->mapped_file = g_mapped_file_new(file_name,
-						    FALSE,
-						    NULL);
+	retval = mapped_file;
 
-		if (!hf->mapped_file) {
-			soup_message_set_status(msg,
-						SOUP_STATUS_NOT_FOUND);
-			goto on_error;
-		}
+	/* A file that has gone live in the meantime is not kept mapped */
 
-		hf->mapped_count = 1;
-	}
+	if (hf->live)
+		goto on_exit;
 
-	if (msg->method == SOUP_METHOD_GET) {
-		g_signal_connect(msg, "finished",
-				 G_CALLBACK(prv_soup_message_finished_cb), hf);
+	hf->mapped_file = g_mapped_file_ref(mapped_file);
+	g_queue_push_tail(&host_service->mapped_files, hf);
+	hf->mapped_link = g_queue_peek_tail_link(&host_service->mapped_files);
+	host_service->mapped_bytes += g_mapped_file_get_length(mapped_file);
 
-		soup_message_set_response(
-				msg, hf->mime_type,
-				SOUP_MEMORY_STATIC,
-				g_mapped_file_get_contents(hf->mapped_file),
-				g_mapped_file_get_length(hf->mapped_file));
-	} else {
-		soup_message_headers_set_content_type(msg->response_headers,
-						      hf->mime_type, NULL);
+	/* Messages hold their own reference to the mapping, so even the
+	   file that has just been mapped can be evicted here if it does
+	   not fit in the budget on its own. */
 
-		soup_message_headers_set_content_length(
-			msg->response_headers,
-			g_mapped_file_get_length(hf->mapped_file));
+	while (host_service->mapped_bytes > host_service->map_budget) {
+		lru = g_queue_peek_head(&host_service->mapped_files);
+		prv_host_file_unmap(lru);
 	}
 
-	soup_message_set_status(msg, SOUP_STATUS_OK);
+on_exit:
 
-on_error:
+	DLEYNA_LOG_DEBUG("Mapped files: %u (%"G_GSIZE_FORMAT" bytes) hits %"
+			 G_GUINT64_FORMAT" misses %"G_GUINT64_FORMAT,
+			 g_queue_get_length(&host_service->mapped_files),
+			 host_service->mapped_bytes,
+			 host_service->map_hits, host_service->map_misses);
 
-	return;
+	g_mutex_unlock(&host_service->lock);
+
+	return retval;
 }
 
-static dlr_host_server_t *prv_host_server_new(const gchar *device_if,
-					      guint port,
-					      GError **error)
+static void prv_host_file_delete(dlr_host_file_t *hf)
 {
-	dlr_host_server_t *server = NULL;
-	SoupAddress *addr;
+	if (hf) {
+		prv_host_file_unmap(hf);
+		g_free(hf->path);
 
-	addr = soup_address_new(device_if, port);
+		g_hash_table_unref(hf->clients);
 
-	if (soup_address_resolve_sync(addr, NULL) != SOUP_STATUS_OK) {
-		*error = g_error_new(DLEYNA_SERVER_ERROR,
-				     DLEYNA_ERROR_HOST_FAILED,
-				     "Unable to create host server on %s",
-				     device_if);
-		goto on_error;
+		g_free(hf->mime_type);
+		g_free(hf->dlna_header);
+		g_free(hf->etag);
+		g_free(hf->source);
+		dlr_seek_index_unref(hf->seek_index);
+		g_free(hf);
 	}
+}
 
-	server = g_new(dlr_host_server_t, 1);
-	server->files = g_hash_table_new_full(g_str_hash, g_str_equal,
-					      g_free, prv_host_file_delete);
-
-	server->soup_server = soup_server_new(SOUP_SERVER_INTERFACE, addr,
-					      NULL);
-	soup_server_add_handler(server->soup_server, DLR_HOST_SERVICE_ROOT,
-				prv_soup_server_cb, server, NULL);
-	soup_server_run_async(server->soup_server);
-	server->counter = 0;
-
-on_error:
+/* Hosted files are referenced by their server and by the requests being
+   served from them.  References are only taken and dropped with the lock
+   held. */
 
-	g_object_unref(addr);
+static dlr_host_file_t *prv_host_file_ref(dlr_host_file_t *hf)
+{
+	hf->ref_count++;
 
-	return server;
+	return hf;
 }
 
-void dlr_host_service_new(dlr_host_service_t **host_service, guint port)
+static void prv_host_file_unref(gpointer host_file)
 {
-	dlr_host_service_t *hs;
-
-	hs = g_new(dlr_host_service_t, 1);
-	hs->servers = g_hash_table_new_full(g_str_hash, g_str_equal,
-					    g_free, prv_host_server_delete);
-	hs->port = port;
+	dlr_host_file_t *hf = host_file;
 
-	*host_service = hs;
+	if (hf && --hf->ref_count == 0)
+		prv_host_file_delete(hf);
 }
 
-static gchar *prv_add_new_file(dlr_host_server_t *server, const gchar *client,
-			       const gchar *device_if, const gchar *file,
-			       GError **error)
+static gboolean prv_is_remote_file(const gchar *file_name)
 {
+	static const gchar *const remote_types[] = {
+		"nfs", "nfs4", "cifs", "smbfs", "smb2", "ncpfs", "afs",
+		"coda", "9p", "fuse", NULL
+	};
+	GFile *file;
+	GFileInfo *info;
+	const gchar *type;
+	gboolean retval = FALSE;
 	unsigned int i;
-	dlr_host_file_t *hf;
-	gchar *str;
 
-	hf = g_hash_table_lookup(server->files, file);
+	file = g_file_new_for_path(file_name);
+	info = g_file_query_filesystem_info(file,
+					    G_FILE_ATTRIBUTE_FILESYSTEM_TYPE,
+					    NULL, NULL);
+	if (!info)
+		goto on_exit;
 
-	if (!hf) {
-		hf = prv_host_file_new(file, server->counter++, error);
+	type = g_file_info_get_attribute_string(
+					info, G_FILE_ATTRIBUTE_FILESYSTEM_TYPE);
 
-		if (!hf)
-			goto on_error;
+	/* FUSE file systems report themselves as fuse.<name> */
 
-		g_ptr_array_add(hf->clients, g_strdup(client));
-		g_hash_table_insert(server->files, g_strdup(file), hf);
-	} else {
-		for (i = 0; i < hf->clients->len; ++i)
-			if (!strcmp(g_ptr_array_index(hf->clients, i), client))
-				break;
+	for (i = 0; type && remote_types[i]; ++i)
+		if (!strcmp(type, remote_types[i]) ||
+		    (g_str_has_prefix(type, remote_types[i]) &&
+		     type[strlen(remote_types[i])] == '.')) {
+			retval = TRUE;
+			break;
+		}
 
-		if (i == hf->clients->len)
-			g_ptr_array_add(hf->clients, g_strdup(client));
-	}
+	DLEYNA_LOG_DEBUG("%s is on a %s file system", file_name,
+			 type ? type : "unknown");
 
-	str = g_strdup_printf("http://%s:%d%s", device_if,
-			      soup_server_get_port(server->soup_server),
-			      hf->path);
+	g_object_unref(info);
 
-	return str;
+on_exit:
 
-on_error:
+	g_object_unref(file);
 
-	return NULL;
+	return retval;
 }
 
-gchar *dlr_host_service_add(dlr_host_service_t *host_service,
-			    const gchar *device_if, const gchar *client,
-			    const gchar *file, GError **error)
+static void prv_set_dlna_operation(gchar *dlna_header,
+				   GUPnPDLNAOperation operation)
 {
-	dlr_host_server_t *server;
-	gchar *retval = NULL;
-
-	server = g_hash_table_lookup(host_service->servers, device_if);
+	gchar *op;
+	gchar value[3];
 
-	if (!server) {
-		server = prv_host_server_new(device_if,
-				     host_service->port,
-				     error);
-
-		if (!server)
-			goto on_error;
+	/* The value always has two digits, so it is updated in place */
 
-		g_hash_table_insert(host_service->servers, g_strdup(device_if),
-				    server);
+	op = dlna_header ? strstr(dlna_header, "DLNA.ORG_OP=") : NULL;
+	if (op) {
+		g_snprintf(value, sizeof(value), "%.2x", operation);
+		memcpy(op + strlen("DLNA.ORG_OP="), value, 2);
 	}
-
-	retval = prv_add_new_file(server, client, device_if, file, error);
-
-on_error:
-
-	return retval;
 }
 
-static gboolean prv_remove_client(dlr_host_service_t *host_service,
-				  const gchar *client,
-				  dlr_host_server_t *server,
-				  const gchar *device_if,
-				  const gchar *file,
-				  dlr_host_file_t *hf)
+static void prv_host_file_set_live(dlr_host_file_t *hf)
 {
-	unsigned int i;
-	gboolean retval = FALSE;
-
-	for (i = 0; i < hf->clients->len; ++i)
-		if (!strcmp(g_ptr_array_index(hf->clients, i), client))
-			break;
-
-	if (i == hf->clients->len)
-		goto on_error;
+	/* A live file is still being written, so it is always streamed
+	   and its size is meaningless.  Neither byte nor time seeking
+	   can be offered either. */
 
-	g_ptr_array_remove_index(hf->clients, i);
+	hf->live = TRUE;
+	hf->streamed = TRUE;
+	hf->size = 0;
+	prv_host_file_unmap(hf);
 
-	retval = TRUE;
+	g_free(hf->etag);
+	hf->etag = NULL;
 
-on_error:
+	dlr_seek_index_unref(hf->seek_index);
+	hf->seek_index = NULL;
 
-	return retval;
+	prv_set_dlna_operation(hf->dlna_header, GUPNP_DLNA_OPERATION_NONE);
 }
 
-gboolean dlr_host_service_remove(dlr_host_service_t *host_service,
-				 const gchar *device_if, const gchar *client,
-				 const gchar *file)
+static dlr_host_file_t *prv_host_file_new(dlr_host_service_t *host_service,
+					  unsigned int id,
+					  const dlr_host_probe_t *probe,
+					  gboolean live)
 {
-	gboolean retval = FALSE;
 	dlr_host_file_t *hf;
-	dlr_host_server_t *server;
+	const gchar *file;
+	gchar *extension;
 
-	server = g_hash_table_lookup(host_service->servers, device_if);
+	hf = g_new0(dlr_host_file_t, 1);
+	hf->ref_count = 1;
+	hf->host_service = host_service;
+	hf->id = id;
 
-	if (!server)
-		goto on_error;
+	/* The file has been stamped by its probe, so that nothing needs
+	   to be read from the file system here, on the main thread. */
 
-	hf = g_hash_table_lookup(server->files, file);
+	if (probe->stamped) {
+		hf->size = probe->stamp.size;
+		prv_host_file_set_validators(hf, &probe->stamp);
+	}
 
-	if (!hf)
-		goto on_error;
+	hf->streamed = probe->streamed;
+	hf->clients = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+					    NULL);
 
-	retval = prv_remove_client(host_service, client, server,
-				   device_if, file, hf);
-	if (!retval)
-		goto on_error;
+	file = probe->variant ? probe->variant : probe->file;
+	extension = strrchr(file, '.');
+	hf->path = g_strdup_printf(DLR_HOST_SERVICE_ROOT"/%d%s",
+				   hf->id, extension ? extension : "");
 
-	if (hf->clients->len == 0)
-		g_hash_table_remove(server->files, file);
+	hf->mime_type = g_strdup(probe->mime_type);
+	hf->dlna_header = g_strdup(probe->dlna_header);
+	hf->source = g_strdup(probe->variant);
 
-	if (g_hash_table_size(server->files) == 0)
-		g_hash_table_remove(host_service->servers, device_if);
+	if (probe->seek_index)
+		hf->seek_index = dlr_seek_index_ref(probe->seek_index);
 
-on_error:
+	if (live)
+		prv_host_file_set_live(hf);
 
-	return retval;
+	return hf;
 }
 
-void dlr_host_service_lost_client(dlr_host_service_t *host_service,
-				  const gchar *client)
+static gboolean prv_host_server_delete_cb(gpointer user_data)
 {
+	dlr_host_server_t *server = user_data;
+	dlr_host_service_t *host_service = server->host_service;
 	GHashTableIter iter;
-	GHashTableIter iter2;
-	gpointer value;
 	gpointer key;
-	gpointer value2;
-	gpointer key2;
-	dlr_host_server_t *server;
-	dlr_host_file_t *hf;
+	dlr_host_transfer_t *transfer;
+	guint count;
+
+	/* Requests still in progress are logged as cut short by the
+	   shutdown, and no longer counted against the server. */
+
+	g_mutex_lock(&host_service->lock);
+	g_hash_table_iter_init(&iter, server->transfers);
+	while (g_hash_table_iter_next(&iter, &key, NULL)) {
+		transfer = key;
+		transfer->server = NULL;
+	}
+	g_hash_table_unref(server->transfers);
+	server->transfers = NULL;
+	g_mutex_unlock(&host_service->lock);
 
-	g_hash_table_iter_init(&iter, host_service->servers);
+	/* A server that could not listen has no SoupServer */
 
-	while (g_hash_table_iter_next(&iter, &key, &value)) {
-		server = value;
-		g_hash_table_iter_init(&iter2, server->files);
+	if (server->soup_server) {
+		soup_server_quit(server->soup_server);
+		g_object_unref(server->soup_server);
+	}
+
+	g_mutex_lock(&host_service->lock);
+	g_hash_table_unref(server->urls);
+	g_hash_table_unref(server->files);
 
-		while (g_hash_table_iter_next(&iter2, &key2, &value2)) {
-			hf = value2;
+	count = GPOINTER_TO_UINT(g_hash_table_lookup(host_service->retiring,
+						     server->device_if));
+	if (count > 1)
+		g_hash_table_insert(host_service->retiring,
+				    g_strdup(server->device_if),
+				    GUINT_TO_POINTER(count - 1));
+	else
+		(void) g_hash_table_remove(host_service->retiring,
+					   server->device_if);
+	g_mutex_unlock(&host_service->lock);
 
-			if (!prv_remove_client(host_service, client, server,
-					       key, key2, hf))
-				continue;
+	/* Transfers still running keep the shaper alive until they end */
 
-			if (hf->clients->len > 0)
-				continue;
+	if (server->shaper)
+		dlr_shaper_unref(server->shaper);
 
-			g_hash_table_iter_remove(&iter2);
-		}
+	g_free(server->device_if);
+	g_free(server);
 
-		if (g_hash_table_size(server->files) == 0)
-			g_hash_table_iter_remove(&iter);
-	}
+	return FALSE;
 }
 
-void dlr_host_service_delete(dlr_host_service_t *host_service)
+static void prv_host_server_delete(gpointer host_server)
+{
+	dlr_host_server_t *server = host_server;
+	dlr_host_service_t *host_service;
+	guint count;
+
+	if (!server)
+		goto on_exit;
+
+	/* The server may be handling a request in the host thread right
+	   now, so it has to be torn down from that thread.  Until it is,
+	   the interface is recorded as having a server retiring, so that
+	   a new server for it waits for the port to be released. */
+
+	host_service = server->host_service;
+
+	g_mutex_lock(&host_service->lock);
+	count = GPOINTER_TO_UINT(g_hash_table_lookup(host_service->retiring,
+						     server->device_if));
+	g_hash_table_insert(host_service->retiring,
+			    g_strdup(server->device_if),
+			    GUINT_TO_POINTER(count + 1));
+	g_mutex_unlock(&host_service->lock);
+
+	g_main_context_invoke(host_service->context,
+			      prv_host_server_delete_cb, server);
+
+on_exit:
+
+	return;
+}
+
+static guint prv_host_server_get_port(dlr_host_server_t *server)
+{
+	/* A server bound on the host thread may not be listening yet, but
+	   the port it will listen on is known unless it is ephemeral, in
+	   which case the server is never bound late. */
+
+	if (server->host_service->port)
+		return server->host_service->port;
+
+	return soup_server_get_port(server->soup_server);
+}
+
+static dlr_host_file_t *prv_host_server_find_file(dlr_host_server_t *hs,
+						  const gchar *url,
+						  const gchar **file_name)
+{
+	dlr_host_file_t *retval = NULL;
+
+	*file_name = g_hash_table_lookup(hs->urls, url);
+
+	if (*file_name)
+		retval = g_hash_table_lookup(hs->files, *file_name);
+
+	/* A scaled photo is served from its copy */
+
+	if (retval && retval->source)
+		*file_name = retval->source;
+
+	return retval;
+}
+
+static void prv_host_transfer_log(dlr_host_transfer_t *transfer,
+				  SoupMessage *msg, gint64 duration)
+{
+	gchar *range;
+	gchar *id;
+	gchar *line;
+	guint64 rate;
+
+	if (transfer->start < 0)
+		range = g_strdup("-");
+	else if (transfer->end < transfer->start)
+		range = g_strdup_printf("%"G_GOFFSET_FORMAT"-",
+					transfer->start);
+	else
+		range = g_strdup_printf("%"G_GOFFSET_FORMAT"-%"
+					G_GOFFSET_FORMAT, transfer->start,
+					transfer->end);
+
+	id = transfer->id < 0 ? g_strdup("-") :
+		g_strdup_printf("%d", transfer->id);
+
+	rate = duration > 0 ? transfer->bytes * G_USEC_PER_SEC / duration : 0;
+
+	line = g_strdup_printf("%s %s \"%s %s\" %u id=%s range=%s sent=%"
+			       G_GUINT64_FORMAT" ms=%"G_GINT64_FORMAT
+			       " rate=%"G_GUINT64_FORMAT" result=%s",
+			       transfer->date, transfer->client,
+			       msg->method, transfer->path,
+			       msg->status_code, id, range, transfer->bytes,
+			       duration / 1000, rate,
+			       transfer->error ? transfer->error :
+			       transfer->wrote_body ? "complete" :
+			       transfer->server ? "disconnected" :
+			       "shutdown");
+
+	DLEYNA_LOG_DEBUG("%s", line);
+
+	if (transfer->host_service->access_log)
+		dlr_access_log_write(transfer->host_service->access_log,
+				     line);
+
+	g_free(line);
+	g_free(id);
+	g_free(range);
+}
+
+static void prv_host_transfer_wrote_data_cb(SoupMessage *msg,
+					    SoupBuffer *chunk,
+					    gpointer user_data)
+{
+	dlr_host_transfer_t *transfer = user_data;
+
+	transfer->bytes += chunk->length;
+}
+
+static void prv_host_transfer_wrote_body_cb(SoupMessage *msg,
+					    gpointer user_data)
+{
+	dlr_host_transfer_t *transfer = user_data;
+
+	transfer->wrote_body = TRUE;
+}
+
+static void prv_host_transfer_finished_cb(SoupMessage *msg,
+					  gpointer user_data)
+{
+	dlr_host_transfer_t *transfer = user_data;
+	dlr_host_service_t *host_service = transfer->host_service;
+	dlr_host_stats_t *stats;
+	gint64 duration;
+
+	duration = g_get_monotonic_time() - transfer->started;
+
+	/* The counters are read from the main thread */
+
+	g_mutex_lock(&host_service->lock);
+
+	if (transfer->server) {
+		stats = &transfer->server->stats;
+		stats->requests++;
+		stats->bytes_sent += transfer->bytes;
+
+		if (transfer->counted) {
+			stats->active--;
+			stats->transfer_time += duration;
+
+			if (transfer->wrote_body && !transfer->error)
+				stats->completed++;
+			else
+				stats->aborted++;
+		}
+
+		(void) g_hash_table_remove(transfer->server->transfers,
+					   transfer);
+	}
+
+	g_mutex_unlock(&host_service->lock);
+
+	prv_host_transfer_log(transfer, msg, duration);
+
+	g_free(transfer->date);
+	g_free(transfer->path);
+	g_free(transfer->client);
+	g_free(transfer);
+}
+
+static dlr_host_transfer_t *prv_host_transfer_new(dlr_host_server_t *hs,
+						  SoupMessage *msg,
+						  SoupClientContext *client,
+						  const char *path)
+{
+	dlr_host_transfer_t *transfer;
+	GDateTime *date;
+
+	transfer = g_new0(dlr_host_transfer_t, 1);
+	transfer->host_service = hs->host_service;
+	transfer->server = hs;
+	transfer->client = g_strdup(soup_client_context_get_host(client));
+	transfer->path = g_strdup(path);
+	transfer->id = -1;
+	transfer->start = -1;
+	transfer->end = -1;
+	transfer->started = g_get_monotonic_time();
+
+	date = g_date_time_new_now_utc();
+	transfer->date = g_date_time_format(date, "%Y-%m-%dT%H:%M:%SZ");
+	g_date_time_unref(date);
+
+	g_signal_connect(msg, "wrote-body-data",
+			 G_CALLBACK(prv_host_transfer_wrote_data_cb), transfer);
+	g_signal_connect(msg, "wrote-body",
+			 G_CALLBACK(prv_host_transfer_wrote_body_cb), transfer);
+	g_signal_connect(msg, "finished",
+			 G_CALLBACK(prv_host_transfer_finished_cb), transfer);
+
+	return transfer;
+}
+
+static void prv_soup_message_finished_cb(SoupMessage *msg, gpointer user_data)
+{
+	GMappedFile *mapped_file = user_data;
+
+	g_mapped_file_unref(mapped_file);
+}
+
+static void prv_host_stream_delete(dlr_host_stream_t *stream)
+{
+	dlr_host_service_t *host_service = stream->host_service;
+
+	(void) g_hash_table_remove(host_service->streams, stream);
+
+	if (stream->source) {
+		g_source_destroy(stream->source);
+		g_source_unref(stream->source);
+	}
+
+	if (stream->wait_source) {
+		g_source_destroy(stream->wait_source);
+		g_source_unref(stream->wait_source);
+	}
+
+	if (stream->watch_source) {
+		g_source_destroy(stream->watch_source);
+		g_source_unref(stream->watch_source);
+	}
+
+	if (stream->watch_fd >= 0)
+		(void) close(stream->watch_fd);
+
+	if (stream->fd >= 0)
+		(void) close(stream->fd);
+
+	if (stream->mapped_file)
+		g_mapped_file_unref(stream->mapped_file);
+
+	dlr_shaper_flow_delete(stream->flow);
+
+	g_free(stream->buffer);
+	g_free(stream->file_name);
+	g_object_unref(stream->soup_server);
+	g_free(stream);
+}
+
+static void prv_host_stream_process(dlr_host_stream_t *stream);
+
+static gsize prv_host_stream_chunk_size(dlr_host_stream_t *stream)
+{
+	gsize length = DLR_HOST_SERVICE_CHUNK_SIZE;
+
+	if (stream->granted)
+		length = stream->granted;
+
+	if (!stream->live)
+		length = MIN(length, stream->end - stream->offset + 1);
+
+	return length;
+}
+
+static void prv_host_stream_schedule(dlr_host_stream_t *stream)
+{
+	/* Reads are only scheduled while fewer than
+	   DLR_HOST_SERVICE_STREAM_AHEAD chunks are waiting to be written,
+	   so a slow client throttles how fast the file is read. */
+
+	if (stream->reading || stream->finished || stream->complete ||
+	    stream->waiting)
+		goto on_exit;
+
+	if (stream->queued >= DLR_HOST_SERVICE_STREAM_AHEAD)
+		goto on_exit;
+
+	/* When the bandwidth is shaped each chunk has to be granted by
+	   the shaper first.  If it cannot be sent yet the stream sleeps
+	   until prv_host_stream_granted_cb is called. */
+
+	if (stream->flow && !stream->granted) {
+		if (stream->throttled)
+			goto on_exit;
+
+		stream->granted = dlr_shaper_flow_request(
+					stream->flow,
+					DLR_HOST_SERVICE_CHUNK_SIZE);
+		if (!stream->granted) {
+			stream->throttled = TRUE;
+			goto on_exit;
+		}
+	}
+
+	/* Mapped files need no reading, the chunk is just a window onto
+	   the mapping. */
+
+	if (stream->mapped_file) {
+		stream->length = prv_host_stream_chunk_size(stream);
+		prv_host_stream_process(stream);
+		goto on_exit;
+	}
+
+	/* Any change notified from now on may not be seen by this read */
+
+	stream->modified = FALSE;
+	stream->reading = TRUE;
+	(void) g_thread_pool_push(stream->host_service->read_pool, stream,
+				  NULL);
+
+on_exit:
+
+	return;
+}
+
+static void prv_host_stream_resume(dlr_host_stream_t *stream)
+{
+	if (!stream->waiting)
+		goto on_exit;
+
+	stream->waiting = FALSE;
+
+	if (stream->wait_source) {
+		g_source_destroy(stream->wait_source);
+		g_source_unref(stream->wait_source);
+		stream->wait_source = NULL;
+	}
+
+	prv_host_stream_schedule(stream);
+
+on_exit:
+
+	return;
+}
+
+static gboolean prv_host_stream_wait_cb(gpointer user_data)
+{
+	dlr_host_stream_t *stream = user_data;
+	guint live_timeout = stream->host_service->live_timeout;
+
+	/* Without a notification of the writer closing the file, a file
+	   that stops growing for live-timeout seconds is assumed to be
+	   complete. */
+
+	if (live_timeout && ++stream->idle >= live_timeout)
+		stream->writer_closed = TRUE;
+
+	prv_host_stream_resume(stream);
+
+	return FALSE;
+}
+
+static void prv_host_stream_wait(dlr_host_stream_t *stream)
+{
+	/* The file changed while it was being read, so there may already
+	   be more data to send. */
+
+	if (stream->modified) {
+		prv_host_stream_schedule(stream);
+		goto on_exit;
+	}
+
+	stream->waiting = TRUE;
+
+	/* When inotify tells us about writes and about the writer closing
+	   the file, there is nothing to do but to wait, however long the
+	   writer pauses.  Otherwise the file is checked for new data
+	   every second. */
+
+	if (stream->close_notified)
+		goto on_exit;
+
+	stream->wait_source = g_timeout_source_new_seconds(1);
+	g_source_set_callback(stream->wait_source, prv_host_stream_wait_cb,
+			      stream, NULL);
+	(void) g_source_attach(stream->wait_source,
+			       stream->host_service->context);
+
+on_exit:
+
+	return;
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+static gboolean prv_host_stream_watch_cb(GIOChannel *source,
+					 GIOCondition condition,
+					 gpointer user_data)
+{
+	dlr_host_stream_t *stream = user_data;
+	struct inotify_event events[16];
+	gssize length;
+	gssize i;
+
+	/* Events for a watch on a single file never carry a name, so
+	   they can be read straight into an array. */
+
+	while ((length = read(stream->watch_fd, events, sizeof(events))) > 0)
+		for (i = 0; i < length / (gssize) sizeof(events[0]); ++i)
+			if (events[i].mask & (IN_CLOSE_WRITE | IN_IGNORED))
+				stream->writer_closed = TRUE;
+
+	stream->modified = TRUE;
+	prv_host_stream_resume(stream);
+
+	return TRUE;
+}
+
+static gboolean prv_has_writers(int fd, gboolean *has_writers)
+{
+	gboolean retval = FALSE;
+
+#ifdef F_SETLEASE
+	/* A read lease is only granted on a file that nobody has open
+	   for writing.  It is given back straight away. */
+
+	if (fcntl(fd, F_SETLEASE, F_RDLCK) == 0) {
+		(void) fcntl(fd, F_SETLEASE, F_UNLCK);
+		*has_writers = FALSE;
+		retval = TRUE;
+	} else if (errno == EAGAIN) {
+		*has_writers = TRUE;
+		retval = TRUE;
+	}
+#endif
+
+	return retval;
+}
+
+static void prv_host_stream_watch(dlr_host_stream_t *stream)
+{
+	GIOChannel *channel;
+	gboolean has_writers;
+
+	/* The watch is made when the stream starts, so a write made
+	   at any point after the file was opened wakes it up. */
+
+	stream->watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (stream->watch_fd < 0)
+		goto on_error;
+
+	if (inotify_add_watch(stream->watch_fd, stream->file_name,
+			      IN_MODIFY | IN_CLOSE_WRITE) < 0) {
+		(void) close(stream->watch_fd);
+		stream->watch_fd = -1;
+		goto on_error;
+	}
+
+	channel = g_io_channel_unix_new(stream->watch_fd);
+	stream->watch_source = g_io_create_watch(channel, G_IO_IN);
+	g_source_set_callback(stream->watch_source,
+			      (GSourceFunc) prv_host_stream_watch_cb,
+			      stream, NULL);
+	(void) g_source_attach(stream->watch_source,
+			       stream->host_service->context);
+	g_io_channel_unref(channel);
+
+	/* A writer that closed the file before the watch was made has
+	   been missed, so we check whether there still is one.  If that
+	   cannot be told, the file is also given up on when it stops
+	   growing for too long. */
+
+	if (prv_has_writers(stream->fd, &has_writers)) {
+		stream->close_notified = TRUE;
+		stream->writer_closed = !has_writers;
+	}
+
+	return;
+
+on_error:
+
+	DLEYNA_LOG_WARNING("Unable to watch %s: %s", stream->file_name,
+			   g_strerror(errno));
+}
+#endif
+
+static void prv_host_stream_process(dlr_host_stream_t *stream)
+{
+	gsize length = MAX(stream->length, 0);
+	gchar *contents;
+
+	if (stream->granted) {
+		if (length < stream->granted)
+			dlr_shaper_flow_refund(stream->flow,
+					       stream->granted - length);
+
+		stream->granted = 0;
+	}
+
+	if ((stream->length < 0) || (stream->length == 0 && !stream->live)) {
+		DLEYNA_LOG_WARNING("Unable to read %s at offset %"
+				   G_GOFFSET_FORMAT": %s", stream->file_name,
+				   stream->offset, stream->length < 0 ?
+				   g_strerror(stream->read_errno) :
+				   "Unexpected end of file");
+
+		/* The headers have already been sent so all we can do is
+		   to cut the response short. */
+
+		stream->complete = TRUE;
+
+		if (stream->transfer)
+			stream->transfer->error = stream->length < 0 ?
+				"read-error" : "truncated";
+	} else if (stream->length == 0 && !stream->writer_closed) {
+		/* A live stream has caught up with the writer */
+
+		prv_host_stream_wait(stream);
+		goto on_exit;
+	} else if (stream->length == 0) {
+		stream->complete = TRUE;
+	} else {
+		if (stream->mapped_file) {
+			contents = g_mapped_file_get_contents(
+							stream->mapped_file);
+			soup_message_body_append(stream->msg->response_body,
+						 SOUP_MEMORY_STATIC,
+						 contents + stream->offset,
+						 stream->length);
+		} else {
+			soup_message_body_append(stream->msg->response_body,
+						 SOUP_MEMORY_TAKE,
+						 stream->buffer,
+						 stream->length);
+			stream->buffer = NULL;
+		}
+
+		stream->offset += stream->length;
+		stream->queued++;
+		stream->idle = 0;
+
+		if (!stream->live && stream->offset > stream->end)
+			stream->complete = TRUE;
+	}
+
+	if (stream->complete)
+		soup_message_body_complete(stream->msg->response_body);
+
+	soup_server_unpause_message(stream->soup_server, stream->msg);
+
+	prv_host_stream_schedule(stream);
+
+on_exit:
+
+	return;
+}
+
+static gboolean prv_host_stream_read_done(gpointer user_data)
+{
+	dlr_host_stream_t *stream = user_data;
+
+	stream->reading = FALSE;
+	g_source_unref(stream->source);
+	stream->source = NULL;
+
+	if (stream->finished)
+		prv_host_stream_delete(stream);
+	else
+		prv_host_stream_process(stream);
+
+	return FALSE;
+}
+
+static void prv_host_stream_read(gpointer data, gpointer user_data)
+{
+	dlr_host_stream_t *stream = data;
+	gsize length = prv_host_stream_chunk_size(stream);
+	GSource *source;
+
+	g_free(stream->buffer);
+	stream->buffer = g_malloc(length);
+	stream->length = pread(stream->fd, stream->buffer, length,
+			       stream->offset);
+	if (stream->length < 0)
+		stream->read_errno = errno;
+
+	source = g_idle_source_new();
+	g_source_set_callback(source, prv_host_stream_read_done, stream, NULL);
+	stream->source = source;
+	(void) g_source_attach(source, stream->host_service->context);
+}
+
+static void prv_host_stream_wrote_chunk_cb(SoupMessage *msg,
+					   gpointer user_data)
+{
+	dlr_host_stream_t *stream = user_data;
+
+	if (stream->queued > 0)
+		stream->queued--;
+
+	prv_host_stream_schedule(stream);
+}
+
+static void prv_host_stream_finished_cb(SoupMessage *msg, gpointer user_data)
+{
+	dlr_host_stream_t *stream = user_data;
+
+	stream->finished = TRUE;
+	stream->transfer = NULL;
+
+	if (!stream->reading)
+		prv_host_stream_delete(stream);
+}
+
+static void prv_host_stream_granted_cb(gsize bytes, gpointer user_data)
+{
+	dlr_host_stream_t *stream = user_data;
+
+	stream->throttled = FALSE;
+	stream->granted = bytes;
+
+	prv_host_stream_schedule(stream);
+}
+
+static dlr_host_stream_t *prv_host_stream_new(dlr_host_server_t *hs,
+					      SoupMessage *msg,
+					      dlr_host_transfer_t *transfer,
+					      const gchar *file_name,
+					      goffset start, goffset end)
+{
+	dlr_host_stream_t *stream;
+
+	stream = g_new0(dlr_host_stream_t, 1);
+	stream->host_service = hs->host_service;
+	stream->soup_server = g_object_ref(hs->soup_server);
+	stream->msg = msg;
+	stream->file_name = g_strdup(file_name);
+	stream->fd = -1;
+	stream->offset = start;
+	stream->end = end;
+	stream->watch_fd = -1;
+	stream->transfer = transfer;
+
+	/* Each transfer is a flow of its own.  A connection only carries
+	   one transfer at a time, so the per flow limit is also a per
+	   connection limit. */
+
+	if (hs->shaper)
+		stream->flow = dlr_shaper_flow_new(hs->shaper,
+						   transfer->client,
+						   prv_host_stream_granted_cb,
+						   stream);
+
+	return stream;
+}
+
+static void prv_host_stream_start(dlr_host_stream_t *stream)
+{
+	SoupMessage *msg = stream->msg;
+
+#ifdef HAVE_SYS_INOTIFY_H
+	if (stream->live)
+		prv_host_stream_watch(stream);
+#endif
+
+	g_hash_table_insert(stream->host_service->streams, stream, stream);
+
+	/* Written chunks are not needed any more */
+
+	soup_message_body_set_accumulate(msg->response_body, FALSE);
+
+	g_signal_connect(msg, "wrote-chunk",
+			 G_CALLBACK(prv_host_stream_wrote_chunk_cb), stream);
+	g_signal_connect(msg, "finished",
+			 G_CALLBACK(prv_host_stream_finished_cb), stream);
+
+	if (!stream->live && stream->end < stream->offset) {
+		stream->complete = TRUE;
+		soup_message_body_complete(msg->response_body);
+	} else {
+		prv_host_stream_schedule(stream);
+	}
+}
+
+static guint prv_get_byte_range(SoupMessage *msg, goffset total_length,
+				goffset *start, goffset *end)
+{
+	SoupRange *ranges = NULL;
+	int n_ranges;
+	guint status = SOUP_STATUS_OK;
+
+	*start = 0;
+	*end = total_length - 1;
+
+	if (!soup_message_headers_get_one(msg->request_headers, "Range"))
+		goto on_exit;
+
+	if (!soup_message_headers_get_ranges(msg->request_headers,
+					     total_length,
+					     &ranges, &n_ranges)) {
+		DLEYNA_LOG_DEBUG("Range not satisfiable");
+
+		status = SOUP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE;
+		goto on_exit;
+	}
+
+	/* We do not generate multipart/byteranges responses */
+
+	if (n_ranges > 1) {
+		DLEYNA_LOG_DEBUG("Multiple ranges requested: %d", n_ranges);
+
+		status = SOUP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE;
+	} else {
+		*start = ranges[0].start;
+		*end = ranges[0].end;
+		status = SOUP_STATUS_PARTIAL_CONTENT;
+	}
+
+	soup_message_headers_free_ranges(msg->request_headers, ranges);
+
+on_exit:
+
+	return status;
+}
+
+static gboolean prv_parse_npt_time(const gchar *str, gchar **end,
+				   gint64 *time)
+{
+	gdouble hours;
+	gdouble minutes;
+	gdouble seconds;
+	gboolean retval = FALSE;
+
+	/* Either seconds, as in 123.45, or hours, minutes and seconds,
+	   as in 0:02:03.45 */
+
+	seconds = g_ascii_strtod(str, end);
+	if (*end == str || seconds < 0)
+		goto on_exit;
+
+	if (**end == ':') {
+		hours = seconds;
+
+		minutes = g_ascii_strtod(*end + 1, end);
+		if (**end != ':' || minutes < 0 || minutes >= 60)
+			goto on_exit;
+
+		seconds = g_ascii_strtod(*end + 1, end);
+		if (seconds < 0 || seconds >= 60)
+			goto on_exit;
+
+		seconds += hours * 3600 + minutes * 60;
+	}
+
+	*time = seconds * 1000;
+	retval = TRUE;
+
+on_exit:
+
+	return retval;
+}
+
+static gboolean prv_parse_npt_range(const gchar *str, gint64 *start,
+				    gint64 *end, gboolean *has_end)
+{
+	gchar *ptr;
+	gboolean retval = FALSE;
+
+	if (!g_str_has_prefix(str, "npt="))
+		goto on_exit;
+
+	if (!prv_parse_npt_time(str + strlen("npt="), &ptr, start) ||
+	    *ptr != '-')
+		goto on_exit;
+
+	++ptr;
+
+	*has_end = *ptr && !g_ascii_isspace(*ptr);
+	if (*has_end && !prv_parse_npt_time(ptr, &ptr, end))
+		goto on_exit;
+
+	retval = TRUE;
+
+on_exit:
+
+	return retval;
+}
+
+static guint prv_get_time_range(SoupMessage *msg, dlr_host_file_t *hf,
+				const char *hdr, goffset total_length,
+				goffset *start, goffset *end)
+{
+	gint64 start_time;
+	gint64 end_time = 0;
+	gint64 duration;
+	gboolean has_end;
+	goffset next;
+	gchar *range;
+	guint status = SOUP_STATUS_OK;
+
+	/* The window sent starts at the index entry at or before the
+	   requested start, so the renderer gets whole frames and the
+	   response header reports the times actually covered. */
+
+	if (!hf->seek_index || total_length <= 0) {
+		status = SOUP_STATUS_NOT_ACCEPTABLE;
+		goto on_exit;
+	}
+
+	if (!prv_parse_npt_range(hdr, &start_time, &end_time, &has_end)) {
+		status = SOUP_STATUS_BAD_REQUEST;
+		goto on_exit;
+	}
+
+	duration = dlr_seek_index_get_duration(hf->seek_index);
+
+	if (start_time > duration || (has_end && end_time < start_time)) {
+		status = SOUP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE;
+		goto on_exit;
+	}
+
+	*start = dlr_seek_index_find(hf->seek_index, start_time,
+				     &start_time);
+	*end = total_length - 1;
+
+	next = -1;
+	if (has_end)
+		next = dlr_seek_index_find_next(hf->seek_index, end_time,
+						&end_time);
+
+	if (next > *start && next <= total_length)
+		*end = next - 1;
+	else
+		end_time = duration;
+
+	if (*start >= total_length) {
+		status = SOUP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE;
+		goto on_exit;
+	}
+
+	range = g_strdup_printf("npt=%"G_GINT64_FORMAT".%03d-%"
+				G_GINT64_FORMAT".%03d/%"G_GINT64_FORMAT
+				".%03d bytes=%"G_GOFFSET_FORMAT"-%"
+				G_GOFFSET_FORMAT"/%"G_GOFFSET_FORMAT,
+				start_time / 1000, (int) (start_time % 1000),
+				end_time / 1000, (int) (end_time % 1000),
+				duration / 1000, (int) (duration % 1000),
+				*start, *end, total_length);
+	soup_message_headers_append(msg->response_headers,
+				    "TimeSeekRange.dlna.org", range);
+	g_free(range);
+
+on_exit:
+
+	return status;
+}
+
+static void prv_add_validators(SoupMessage *msg, dlr_host_file_t *hf)
+{
+	SoupDate *date;
+	gchar *last_modified;
+
+	soup_message_headers_replace(msg->response_headers, "ETag", hf->etag);
+
+	date = soup_date_new_from_time_t(hf->mtime);
+	last_modified = soup_date_to_string(date, SOUP_DATE_HTTP);
+	soup_message_headers_replace(msg->response_headers, "Last-Modified",
+				     last_modified);
+	g_free(last_modified);
+	soup_date_free(date);
+}
+
+static gboolean prv_is_not_modified(SoupMessage *msg, dlr_host_file_t *hf)
+{
+	const char *hdr;
+	GSList *etags;
+	GSList *l;
+	const char *etag;
+	SoupDate *date;
+	gboolean retval = FALSE;
+
+	/* If-None-Match takes precedence over If-Modified-Since.  Weak
+	   comparison is used, as allowed for GET and HEAD requests. */
+
+	hdr = soup_message_headers_get_list(msg->request_headers,
+					    "If-None-Match");
+	if (hdr) {
+		etags = soup_header_parse_list(hdr);
+
+		for (l = etags; l && !retval; l = l->next) {
+			etag = l->data;
+
+			if (g_str_has_prefix(etag, "W/"))
+				etag += 2;
+
+			retval = !strcmp(etag, "*") || !strcmp(etag, hf->etag);
+		}
+
+		soup_header_free_list(etags);
+
+		goto on_exit;
+	}
+
+	hdr = soup_message_headers_get_one(msg->request_headers,
+					   "If-Modified-Since");
+	if (hdr) {
+		date = soup_date_new_from_string(hdr);
+
+		if (date) {
+			retval = hf->mtime <= soup_date_to_time_t(date);
+			soup_date_free(date);
+		}
+	}
+
+on_exit:
+
+	return retval;
+}
+
+static void prv_soup_server_cb(SoupServer *server, SoupMessage *msg,
+			       const char *path, GHashTable *query,
+			       SoupClientContext *client, gpointer user_data)
+{
+	dlr_host_file_t *hf = NULL;
+	dlr_host_server_t *hs = user_data;
+	dlr_host_service_t *host_service = hs->host_service;
+	GMappedFile *mapped_file = NULL;
+	dlr_host_transfer_t *transfer;
+	dlr_host_stream_t *stream;
+	gchar *file_name = NULL;
+	const gchar *name;
+	const char *hdr;
+	gboolean streamed;
+	goffset total_length;
+	goffset length;
+	goffset start;
+	goffset end;
+	guint status;
+	gchar *content_range;
+	GStatBuf buf;
+	gboolean stamped;
+	int fd = -1;
+
+	/* Requests are served from the host thread.  The lock protects
+	   the hosted files against changes made from the main thread, but
+	   it is released while the file is opened or mapped.  The file is
+	   referenced meanwhile so that it cannot be freed under us. */
+
+	g_mutex_lock(&host_service->lock);
+
+	transfer = prv_host_transfer_new(hs, msg, client, path);
+	g_hash_table_add(hs->transfers, transfer);
+
+	if ((msg->method != SOUP_METHOD_GET) &&
+	    (msg->method != SOUP_METHOD_HEAD)) {
+		soup_message_set_status(msg, SOUP_STATUS_NOT_IMPLEMENTED);
+		goto on_error;
+	}
+
+	hf = prv_host_server_find_file(hs, path, &name);
+
+	if (!hf) {
+		soup_message_set_status(msg, SOUP_STATUS_NOT_FOUND);
+		goto on_error;
+	}
+
+	hf = prv_host_file_ref(hf);
+	file_name = g_strdup(name);
+
+	transfer->id = hf->id;
+
+	hdr = soup_message_headers_get_one(msg->request_headers,
+					   "getContentFeatures.dlna.org");
+
+	if (hdr) {
+		if (strcmp(hdr, "1") != 0) {
+			soup_message_set_status(msg, SOUP_STATUS_BAD_REQUEST);
+			goto on_error;
+		}
+
+		if ((hf->dlna_header) && strlen(hf->dlna_header) > 0)
+			soup_message_headers_append(msg->response_headers,
+						    "contentFeatures.dlna.org",
+						    hf->dlna_header);
+	}
+
+	/* A live file is sent from its start to wherever the writer has
+	   got to when it closes the file.  As neither the length nor the
+	   ranges are known up front the body is sent chunked, or up to
+	   the end of the connection for HTTP/1.0 clients. */
+
+	if (hf->live) {
+		soup_message_headers_append(msg->response_headers,
+					    "Accept-Ranges", "none");
+		soup_message_headers_set_content_type(msg->response_headers,
+						      hf->mime_type, NULL);
+		soup_message_headers_set_encoding(
+			msg->response_headers,
+			soup_message_get_http_version(msg) == SOUP_HTTP_1_0 ?
+			SOUP_ENCODING_EOF : SOUP_ENCODING_CHUNKED);
+
+		if (msg->method == SOUP_METHOD_GET) {
+			g_mutex_unlock(&host_service->lock);
+			fd = g_open(file_name, O_RDONLY, 0);
+			g_mutex_lock(&host_service->lock);
+
+			if (fd < 0) {
+				soup_message_set_status(msg,
+							SOUP_STATUS_NOT_FOUND);
+				goto on_error;
+			}
+
+			stream = prv_host_stream_new(hs, msg, transfer,
+						     file_name, 0, -1);
+			stream->fd = fd;
+			stream->live = hf->live;
+			prv_host_stream_start(stream);
+
+			transfer->start = 0;
+		}
+
+		soup_message_set_status(msg, SOUP_STATUS_OK);
+		goto on_error;
+	}
+
+	/* The file may have changed since it was hosted or mapped, so it
+	   is stat'ed again before its validators and size are used. */
+
+	g_mutex_unlock(&host_service->lock);
+	stamped = g_stat(file_name, &buf) == 0;
+	g_mutex_lock(&host_service->lock);
+
+	if (!stamped) {
+		soup_message_set_status(msg, SOUP_STATUS_NOT_FOUND);
+		goto on_error;
+	}
+
+	prv_host_file_restamp(hf, &buf);
+
+	/* Repeated requests for an unchanged file are answered without a
+	   body, and without opening the file. */
+
+	if (hf->etag && prv_is_not_modified(msg, hf)) {
+		prv_add_validators(msg, hf);
+		soup_message_set_status(msg, SOUP_STATUS_NOT_MODIFIED);
+		goto on_error;
+	}
+
+	/* HEAD requests, which many renderers send before every GET, are
+	   answered from the size the file has just been found to have,
+	   without opening it.  Streamed files are not mapped but opened,
+	   once the request has been validated. */
+
+	streamed = hf->streamed;
+
+	if ((msg->method == SOUP_METHOD_HEAD) || streamed) {
+		total_length = hf->size;
+	} else {
+		g_mutex_unlock(&host_service->lock);
+		mapped_file = prv_host_file_map(hf, file_name);
+		g_mutex_lock(&host_service->lock);
+
+		if (!mapped_file) {
+			soup_message_set_status(msg, SOUP_STATUS_NOT_FOUND);
+			goto on_error;
+		}
+
+		g_signal_connect(msg, "finished",
+				 G_CALLBACK(prv_soup_message_finished_cb),
+				 mapped_file);
+
+		total_length = g_mapped_file_get_length(mapped_file);
+		hf->size = total_length;
+	}
+
+	soup_message_headers_append(msg->response_headers, "Accept-Ranges",
+				    "bytes");
+
+	status = SOUP_STATUS_OK;
+
+	/* A time based seek takes precedence over a byte range, and is
+	   answered with a 200 as required by DLNA. */
+
+	hdr = soup_message_headers_get_one(msg->request_headers,
+					   "TimeSeekRange.dlna.org");
+
+	if (hdr)
+		status = prv_get_time_range(msg, hf, hdr, total_length,
+					    &start, &end);
+	else if (total_length > 0)
+		status = prv_get_byte_range(msg, total_length, &start, &end);
+	else
+		start = end = 0;
+
+	if ((status == SOUP_STATUS_NOT_ACCEPTABLE) ||
+	    (status == SOUP_STATUS_BAD_REQUEST)) {
+		soup_message_set_status(msg, status);
+		goto on_error;
+	}
+
+	if (status == SOUP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE) {
+		content_range = g_strdup_printf("bytes */%"G_GOFFSET_FORMAT,
+						total_length);
+		soup_message_headers_append(msg->response_headers,
+					    "Content-Range", content_range);
+		g_free(content_range);
+
+		soup_message_set_status(msg, status);
+		goto on_error;
+	}
+
+	if (hf->etag)
+		prv_add_validators(msg, hf);
+
+	if (status == SOUP_STATUS_PARTIAL_CONTENT)
+		soup_message_headers_set_content_range(msg->response_headers,
+						       start, end,
+						       total_length);
+
+	length = total_length > 0 ? end - start + 1 : 0;
+
+	if ((msg->method == SOUP_METHOD_GET) && streamed) {
+		soup_message_headers_set_content_type(msg->response_headers,
+						      hf->mime_type, NULL);
+		soup_message_headers_set_content_length(msg->response_headers,
+							length);
+
+		g_mutex_unlock(&host_service->lock);
+		fd = g_open(file_name, O_RDONLY, 0);
+		g_mutex_lock(&host_service->lock);
+
+		if (fd < 0) {
+			soup_message_set_status(msg, SOUP_STATUS_NOT_FOUND);
+			goto on_error;
+		}
+
+		stream = prv_host_stream_new(hs, msg, transfer, file_name,
+					     start, start + length - 1);
+		stream->fd = fd;
+		prv_host_stream_start(stream);
+	} else if (msg->method == SOUP_METHOD_GET) {
+		/* Only the requested window of the mapping is handed to
+		   libsoup, so only the pages actually sent are faulted in. */
+
+		if (total_length > 0)
+			prv_advise_mapping(mapped_file, start, end - start + 1,
+					   FALSE);
+
+		/* When the bandwidth is shaped, mapped files are sent in
+		   chunks like streamed ones, so that they take their
+		   turn with the other transfers. */
+
+		if (hs->shaper) {
+			soup_message_headers_set_content_type(
+				msg->response_headers, hf->mime_type, NULL);
+			soup_message_headers_set_content_length(
+				msg->response_headers, length);
+
+			stream = prv_host_stream_new(hs, msg, transfer,
+						     file_name, start,
+						     start + length - 1);
+			stream->mapped_file = g_mapped_file_ref(mapped_file);
+			prv_host_stream_start(stream);
+		} else {
+			soup_message_set_response(
+				msg, hf->mime_type,
+				SOUP_MEMORY_STATIC,
+				g_mapped_file_get_contents(mapped_file) + start,
+				length);
+		}
+	} else {
+		soup_message_headers_set_content_type(msg->response_headers,
+						      hf->mime_type, NULL);
+		soup_message_headers_set_content_length(msg->response_headers,
+							length);
+	}
+
+	if (msg->method == SOUP_METHOD_GET) {
+		transfer->start = start;
+		transfer->end = start + length - 1;
+	}
+
+	soup_message_set_status(msg, status);
+
+on_error:
+
+	/* Only GET requests that are answered with content count as
+	   transfers.  Everything else is just a request. */
+
+	if ((msg->method == SOUP_METHOD_GET) &&
+	    SOUP_STATUS_IS_SUCCESSFUL(msg->status_code)) {
+		transfer->counted = TRUE;
+		hs->stats.active++;
+	}
+
+	prv_host_file_unref(hf);
+
+	g_mutex_unlock(&host_service->lock);
+
+	g_free(file_name);
+
+	return;
+}
+
+static gboolean prv_host_server_listen(dlr_host_server_t *server)
+{
+	dlr_host_service_t *host_service = server->host_service;
+	SoupAddress *addr;
+	gboolean retval = FALSE;
+
+	addr = soup_address_new(server->device_if, host_service->port);
+
+	if (soup_address_resolve_sync(addr, NULL) != SOUP_STATUS_OK)
+		goto on_error;
+
+	server->soup_server = soup_server_new(SOUP_SERVER_INTERFACE, addr,
+					      SOUP_SERVER_ASYNC_CONTEXT,
+					      host_service->context,
+					      NULL);
+	if (!server->soup_server)
+		goto on_error;
+
+	soup_server_add_handler(server->soup_server, DLR_HOST_SERVICE_ROOT,
+				prv_soup_server_cb, server, NULL);
+	soup_server_run_async(server->soup_server);
+
+	retval = TRUE;
+
+on_error:
+
+	g_object_unref(addr);
+
+	return retval;
+}
+
+static gboolean prv_host_server_listen_cb(gpointer user_data)
+{
+	dlr_host_server_t *server = user_data;
+
+	if (!prv_host_server_listen(server))
+		DLEYNA_LOG_WARNING("Unable to create host server on %s",
+				   server->device_if);
+
+	return FALSE;
+}
+
+static dlr_host_server_t *prv_host_server_new(
+					dlr_host_service_t *host_service,
+					const gchar *device_if,
+					GError **error)
+{
+	dlr_host_server_t *server;
+	gboolean retiring;
+
+	server = g_new(dlr_host_server_t, 1);
+	server->host_service = host_service;
+	server->device_if = g_strdup(device_if);
+	server->files = g_hash_table_new_full(g_str_hash, g_str_equal,
+					      g_free, prv_host_file_unref);
+
+	/* Maps the URL path of each hosted file onto its key in files.
+	   Neither the keys nor the values are owned by this table. */
+	server->urls = g_hash_table_new(g_str_hash, g_str_equal);
+	server->transfers = g_hash_table_new(g_direct_hash, g_direct_equal);
+	memset(&server->stats, 0, sizeof(server->stats));
+	server->soup_server = NULL;
+	server->counter = 0;
+
+	/* A fixed port is still held by a server of this interface that
+	   is being torn down.  The new server is bound on the host thread
+	   once the old one is gone, rather than waiting for it here. */
+
+	g_mutex_lock(&host_service->lock);
+	retiring = host_service->port &&
+		g_hash_table_contains(host_service->retiring, device_if);
+	g_mutex_unlock(&host_service->lock);
+
+	if (retiring) {
+		g_main_context_invoke(host_service->context,
+				      prv_host_server_listen_cb, server);
+	} else if (!prv_host_server_listen(server)) {
+		*error = g_error_new(DLEYNA_SERVER_ERROR,
+				     DLEYNA_ERROR_HOST_FAILED,
+				     "Unable to create host server on %s",
+				     device_if);
+
+		g_hash_table_unref(server->transfers);
+		g_hash_table_unref(server->urls);
+		g_hash_table_unref(server->files);
+		g_free(server->device_if);
+		g_free(server);
+		server = NULL;
+
+		goto on_error;
+	}
+
+	/* Each server shapes the bandwidth of the interface it listens
+	   on.  Without any limit configured there is nothing to share
+	   out, and files are sent as fast as the clients take them. */
+
+	server->shaper = NULL;
+	if (host_service->max_rate || host_service->client_max_rate ||
+	    host_service->connection_max_rate)
+		server->shaper = dlr_shaper_new(
+					host_service->context,
+					host_service->max_rate,
+					host_service->client_max_rate,
+					host_service->connection_max_rate);
+
+on_error:
+
+	return server;
+}
+
+static void prv_host_waiter_delete(gpointer host_waiter)
+{
+	dlr_host_waiter_t *waiter = host_waiter;
+
+	if (waiter) {
+		if (waiter->cancel_id)
+			g_cancellable_disconnect(waiter->cancellable,
+						 waiter->cancel_id);
+		if (waiter->cancellable)
+			g_object_unref(waiter->cancellable);
+
+		g_free(waiter->device_if);
+		g_free(waiter->client);
+		g_free(waiter);
+	}
+}
+
+static void prv_host_probe_delete(gpointer host_probe)
+{
+	dlr_host_probe_t *probe = host_probe;
+
+	if (probe) {
+		if (probe->source) {
+			g_source_destroy(probe->source);
+			g_source_unref(probe->source);
+		}
+
+		g_ptr_array_unref(probe->waiters);
+
+		if (probe->error)
+			g_error_free(probe->error);
+
+		g_free(probe->key);
+		g_free(probe->file);
+		g_free(probe->variant);
+		g_free(probe->mime_type);
+		g_free(probe->dlna_header);
+		dlr_seek_index_unref(probe->seek_index);
+		g_free(probe);
+	}
+}
+
+static dlr_host_probe_t *prv_host_probe_new(dlr_host_service_t *host_service,
+					    const gchar *key,
+					    const gchar *file)
+{
+	dlr_host_probe_t *probe;
+
+	probe = g_new0(dlr_host_probe_t, 1);
+	probe->host_service = host_service;
+	probe->key = g_strdup(key);
+	probe->file = g_strdup(file);
+	probe->waiters = g_ptr_array_new_with_free_func(prv_host_waiter_delete);
+
+	return probe;
+}
+
+static void prv_host_waiter_cancelled(GCancellable *cancellable,
+				      gpointer user_data)
+{
+	dlr_host_waiter_t *waiter = user_data;
+	dlr_host_service_add_cb_t cb = waiter->cb;
+	gpointer cb_user_data = waiter->user_data;
+	GError *error;
+
+	/* The probe itself cannot be interrupted.  We just forget about
+	   this waiter and let the probe complete for any others. */
+
+	waiter->cancel_id = 0;
+	(void) g_ptr_array_remove(waiter->probe->waiters, waiter);
+
+	error = g_error_new(DLEYNA_SERVER_ERROR, DLEYNA_ERROR_CANCELLED,
+			    "Operation cancelled.");
+	cb(NULL, error, cb_user_data);
+	g_error_free(error);
+}
+
+static void prv_host_client_delete(gpointer host_client)
+{
+	dlr_host_client_t *hc = host_client;
+
+	if (hc) {
+		g_hash_table_unref(hc->files);
+		g_hash_table_unref(hc->local_files);
+		g_free(hc);
+	}
+}
+
+static dlr_host_client_t *prv_get_client(dlr_host_service_t *host_service,
+					 const gchar *client)
+{
+	dlr_host_client_t *hc;
+
+	hc = g_hash_table_lookup(host_service->clients, client);
+
+	if (!hc) {
+		hc = g_new0(dlr_host_client_t, 1);
+		hc->files = g_hash_table_new(g_direct_hash, g_direct_equal);
+		hc->local_files = g_hash_table_new_full(g_str_hash,
+							g_str_equal,
+							g_free, NULL);
+		g_hash_table_insert(host_service->clients, g_strdup(client),
+				    hc);
+	}
+
+	return hc;
+}
+
+static void prv_release_client(dlr_host_service_t *host_service,
+			       const gchar *client)
+{
+	dlr_host_client_t *hc;
+
+	hc = g_hash_table_lookup(host_service->clients, client);
+
+	if (hc && g_hash_table_size(hc->files) == 0 &&
+	    g_hash_table_size(hc->local_files) == 0)
+		g_hash_table_remove(host_service->clients, client);
+}
+
+static void prv_add_client(dlr_host_file_t *hf, const gchar *client)
+{
+	dlr_host_client_t *hc;
+
+	if (g_hash_table_contains(hf->clients, client))
+		goto on_exit;
+
+	(void) g_hash_table_add(hf->clients, g_strdup(client));
+
+	hc = prv_get_client(hf->host_service, client);
+	(void) g_hash_table_add(hc->files, hf);
+
+on_exit:
+
+	return;
+}
+
+static gboolean prv_remove_client(dlr_host_service_t *host_service,
+				  const gchar *client,
+				  dlr_host_file_t *hf)
+{
+	dlr_host_client_t *hc;
+	gboolean retval = FALSE;
+
+	if (!g_hash_table_remove(hf->clients, client))
+		goto on_error;
+
+	hc = g_hash_table_lookup(host_service->clients, client);
+	if (hc) {
+		(void) g_hash_table_remove(hc->files, hf);
+		prv_release_client(host_service, client);
+	}
+
+	retval = TRUE;
+
+on_error:
+
+	return retval;
+}
+
+static void prv_unhost_file(dlr_host_service_t *host_service,
+			    dlr_host_file_t *hf)
+{
+	dlr_host_server_t *server = hf->server;
+
+	if (g_hash_table_size(hf->clients) > 0)
+		goto on_exit;
+
+	g_mutex_lock(&host_service->lock);
+	g_hash_table_remove(server->urls, hf->path);
+	g_hash_table_remove(server->files, hf->key);
+	g_mutex_unlock(&host_service->lock);
+
+	if (g_hash_table_size(server->files) == 0)
+		g_hash_table_remove(host_service->servers, server->device_if);
+
+on_exit:
+
+	return;
+}
+
+static gchar *prv_add_new_file(dlr_host_server_t *server, const gchar *client,
+			       const gchar *device_if, const gchar *file,
+			       const dlr_host_probe_t *probe, gboolean live)
+{
+	dlr_host_file_t *hf;
+	gchar *str;
+	gchar *key;
+
+	/* Files that are not hosted yet have been probed */
+
+	hf = g_hash_table_lookup(server->files, file);
+
+	if (!hf) {
+		hf = prv_host_file_new(server->host_service,
+				       server->counter++, probe, live);
+
+		key = g_strdup(file);
+		hf->server = server;
+		hf->key = key;
+
+		g_mutex_lock(&server->host_service->lock);
+		g_hash_table_insert(server->files, key, hf);
+		g_hash_table_insert(server->urls, hf->path, key);
+		g_mutex_unlock(&server->host_service->lock);
+
+		prv_add_client(hf, client);
+	} else {
+		prv_add_client(hf, client);
+
+		if (live && !hf->live) {
+			g_mutex_lock(&server->host_service->lock);
+			prv_host_file_set_live(hf);
+			g_mutex_unlock(&server->host_service->lock);
+		}
+	}
+
+	/* A photo that did not need scaling for a profile is recorded as
+	   fitting it, so that it is not probed again for that profile or
+	   for any larger one. */
+
+	if (probe && probe->image_profile && !probe->variant) {
+		g_mutex_lock(&server->host_service->lock);
+		if (!hf->image_fit || probe->image_profile < hf->image_fit)
+			hf->image_fit = probe->image_profile;
+		g_mutex_unlock(&server->host_service->lock);
+	}
+
+	str = g_strdup_printf("http://%s:%d%s", device_if,
+			      prv_host_server_get_port(server),
+			      hf->path);
+
+	return str;
+}
+
+static gchar *prv_add_profiled_file(dlr_host_service_t *host_service,
+				    const gchar *device_if,
+				    const gchar *client, const gchar *file,
+				    const dlr_host_probe_t *probe,
+				    gboolean live, GError **error)
+{
+	dlr_host_server_t *server;
+	gchar *retval = NULL;
+
+	/* If the file was probed the server is looked up again as it may
+	   have been removed in the meantime. */
+
+	server = g_hash_table_lookup(host_service->servers, device_if);
+
+	if (!server) {
+		server = prv_host_server_new(host_service, device_if, error);
+
+		if (!server)
+			goto on_error;
+
+		g_hash_table_insert(host_service->servers, g_strdup(device_if),
+				    server);
+	}
+
+	retval = prv_add_new_file(server, client, device_if, file, probe,
+				  live);
+
+on_error:
+
+	return retval;
+}
+
+static GUPnPDLNAProfileGuesser *prv_get_guesser(void)
+{
+	gboolean relaxed_mode = TRUE;
+	gboolean extended_mode = TRUE;
+	GUPnPDLNAProfileGuesser *guesser;
+
+	/* Creating a guesser loads the whole DLNA profile set, so it is
+	   only done the first time a thread probes a file. */
+
+	guesser = g_private_get(&g_guesser);
+	if (!guesser) {
+		guesser = gupnp_dlna_profile_guesser_new(relaxed_mode,
+							 extended_mode);
+		g_private_set(&g_guesser, guesser);
+	}
+
+	return guesser;
+}
+
+static void prv_add_local_file(dlr_host_service_t *host_service,
+			       const gchar *client, const gchar *file)
+{
+	GHashTable *clients;
+	dlr_host_client_t *hc;
+
+	clients = g_hash_table_lookup(host_service->local_files, file);
+	if (!clients) {
+		clients = g_hash_table_new_full(g_str_hash, g_str_equal,
+						g_free, NULL);
+		g_hash_table_insert(host_service->local_files, g_strdup(file),
+				    clients);
+	}
+
+	if (!g_hash_table_contains(clients, client)) {
+		(void) g_hash_table_add(clients, g_strdup(client));
+
+		hc = prv_get_client(host_service, client);
+		(void) g_hash_table_add(hc->local_files, g_strdup(file));
+	}
+}
+
+static void prv_host_local_probe_done(dlr_host_probe_t *probe)
+{
+	dlr_host_service_t *host_service = probe->host_service;
+	dlr_host_waiter_t *waiter;
+	unsigned int i;
+
+	if (probe->regular)
+		DLEYNA_LOG_DEBUG("Passing %s to a local renderer as %s",
+				 probe->file, probe->key);
+
+	for (i = 0; i < probe->waiters->len; ++i) {
+		waiter = g_ptr_array_index(probe->waiters, i);
+
+		if (waiter->cancel_id) {
+			g_cancellable_disconnect(waiter->cancellable,
+						 waiter->cancel_id);
+			waiter->cancel_id = 0;
+		}
+
+		/* Anything the renderer might not be able to open itself
+		   is left to the web server, which also reports any
+		   error. */
+
+		if (probe->regular) {
+			prv_add_local_file(host_service, waiter->client,
+					   probe->file);
+			waiter->cb(probe->key, NULL, waiter->user_data);
+		} else {
+			dlr_host_service_add(host_service, waiter->device_if,
+					     waiter->client, probe->file,
+					     waiter->live, FALSE,
+					     waiter->image_profile,
+					     waiter->cancellable, waiter->cb,
+					     waiter->user_data);
+		}
+	}
+}
+
+static gboolean prv_host_probe_done(gpointer user_data)
+{
+	dlr_host_probe_t *probe = user_data;
+	dlr_host_service_t *host_service = probe->host_service;
+	dlr_host_waiter_t *waiter;
+	unsigned int i;
+	gchar *url;
+	gchar *seek_index = NULL;
+	const gchar *key;
+	GError *error;
+
+	(void) g_hash_table_steal(host_service->probes, probe->key);
+
+	if (probe->read_ahead)
+		goto on_exit;
+
+	if (probe->local) {
+		prv_host_local_probe_done(probe);
+		goto on_exit;
+	}
+
+	if (probe->seek_index)
+		seek_index = dlr_seek_index_to_string(probe->seek_index);
+
+	/* The profile of a file that is still being written is not
+	   worth keeping as the file changes under it. */
+
+	if (!probe->error && probe->stamped && !probe->cached && !probe->live)
+		dlr_profile_cache_insert(host_service->profiles,
+					 probe->variant ? probe->variant :
+					 probe->file,
+					 &probe->stamp, probe->mime_type,
+					 probe->dlna_header, seek_index);
+	g_free(seek_index);
+
+	/* A photo that did not need scaling is hosted as usual */
+
+	key = probe->variant ? probe->key : probe->file;
+
+	for (i = 0; i < probe->waiters->len; ++i) {
+		waiter = g_ptr_array_index(probe->waiters, i);
+
+		if (waiter->cancel_id) {
+			g_cancellable_disconnect(waiter->cancellable,
+						 waiter->cancel_id);
+			waiter->cancel_id = 0;
+		}
+
+		url = NULL;
+		error = NULL;
+
+		if (probe->error)
+			error = g_error_copy(probe->error);
+		else
+			url = prv_add_profiled_file(host_service,
+						    waiter->device_if,
+						    waiter->client,
+						    key, probe,
+						    waiter->live, &error);
+
+		waiter->cb(url, error, waiter->user_data);
+
+		g_free(url);
+		if (error)
+			g_error_free(error);
+	}
+
+on_exit:
+
+	prv_host_probe_delete(probe);
+
+	return FALSE;
+}
+
+static void prv_host_probe_read_ahead(dlr_host_probe_t *probe)
+{
+#ifdef HAVE_POSIX_FADVISE
+	int fd;
+
+	fd = g_open(probe->file, O_RDONLY, 0);
+	if (fd < 0)
+		goto on_exit;
+
+	/* The kernel reads the data in the background */
+
+	(void) posix_fadvise(fd, 0, probe->read_ahead, POSIX_FADV_WILLNEED);
+	(void) close(fd);
+
+on_exit:
+
+	return;
+#endif
+}
+
+static void prv_host_probe_run(gpointer data, gpointer user_data)
+{
+	dlr_host_probe_t *probe = data;
+	dlr_host_service_t *host_service = probe->host_service;
+	const gchar *file = probe->file;
+	gchar *seek_index = NULL;
+	GSource *source;
+
+	/* Read ahead requests only share the pool with the probes, and
+	   have no result to hand back. */
+
+	if (probe->read_ahead) {
+		prv_host_probe_read_ahead(probe);
+		goto on_exit;
+	}
+
+	/* A file passed to a local renderer is only checked, as it is the
+	   renderer that opens it. */
+
+	if (probe->local) {
+		probe->regular = g_file_test(file, G_FILE_TEST_IS_REGULAR);
+		goto on_exit;
+	}
+
+	/* Even checking that the file exists can block on a remote
+	   mount, so it is done here rather than when the file is added. */
+
+	if (!g_file_test(file, G_FILE_TEST_IS_REGULAR | G_FILE_TEST_EXISTS)) {
+		probe->error = g_error_new(DLEYNA_SERVER_ERROR,
+					   DLEYNA_ERROR_OBJECT_NOT_FOUND,
+					   "File %s does not exist or is not a regular file",
+					   file);
+		goto on_exit;
+	}
+
+	/* A photo too large for the renderer is scaled first, and it is
+	   the copy that is then probed. */
+
+	if (probe->image_profile) {
+		probe->variant = dlr_image_scaler_scale(
+					probe->file, probe->image_profile,
+					host_service->image_cache_dir);
+		if (probe->variant)
+			file = probe->variant;
+	}
+
+	/* The file is stamped before it is probed so that a change made
+	   while probing invalidates the cached profile. */
+
+	probe->stamped = dlr_profile_cache_stamp(file, &probe->stamp);
+	probe->streamed = prv_is_remote_file(file) ||
+		(probe->stamped &&
+		 probe->stamp.size > host_service->stream_threshold);
+
+	/* Files profiled before, and not modified since, are not probed
+	   again. */
+
+	if (probe->stamped)
+		probe->cached = dlr_profile_cache_lookup(host_service->profiles,
+							 file, &probe->stamp,
+							 &probe->mime_type,
+							 &probe->dlna_header,
+							 &seek_index);
+
+	if (probe->cached) {
+		if (seek_index)
+			probe->seek_index =
+				dlr_seek_index_new_from_string(seek_index);
+		g_free(seek_index);
+
+		goto on_exit;
+	}
+
+	prv_compute_mime_and_dlna_header(prv_get_guesser(),
+					 file, &probe->mime_type,
+					 &probe->dlna_header, &probe->error);
+
+	/* Files that can be indexed can also be seeked by time */
+
+	if (!probe->error)
+		probe->seek_index = dlr_seek_index_new(file);
+
+	if (probe->seek_index)
+		prv_set_dlna_operation(probe->dlna_header,
+				       GUPNP_DLNA_OPERATION_RANGE |
+				       GUPNP_DLNA_OPERATION_TIMESEEK);
+
+on_exit:
+
+	/* The results are handed back to the main loop.  The source is
+	   recorded before it is attached so that it can never run before
+	   this thread is done with the probe. */
+
+	source = g_idle_source_new();
+	g_source_set_callback(source, prv_host_probe_done, probe, NULL);
+	probe->source = source;
+	(void) g_source_attach(source, NULL);
+}
+
+static gpointer prv_host_thread(gpointer user_data)
+{
+	dlr_host_service_t *host_service = user_data;
+
+	g_main_context_push_thread_default(host_service->context);
+	g_main_loop_run(host_service->loop);
+	g_main_context_pop_thread_default(host_service->context);
+
+	return NULL;
+}
+
+static gboolean prv_host_thread_quit_cb(gpointer user_data)
+{
+	dlr_host_service_t *host_service = user_data;
+	GList *streams;
+	GList *l;
+	dlr_host_stream_t *stream;
+
+	/* Streams still in progress are detached from their messages
+	   before the loop stops. */
+
+	g_thread_pool_free(host_service->read_pool, TRUE, TRUE);
+
+	streams = g_hash_table_get_keys(host_service->streams);
+	for (l = streams; l; l = l->next) {
+		stream = l->data;
+		g_signal_handlers_disconnect_by_func(
+			stream->msg,
+			G_CALLBACK(prv_host_stream_wrote_chunk_cb),
+			stream);
+		g_signal_handlers_disconnect_by_func(
+			stream->msg,
+			G_CALLBACK(prv_host_stream_finished_cb),
+			stream);
+		prv_host_stream_delete(stream);
+	}
+	g_list_free(streams);
+
+	g_main_loop_quit(host_service->loop);
+
+	return FALSE;
+}
+
+static guint prv_kib_to_bytes(guint kib)
+{
+	return MIN(kib, G_MAXUINT / 1024) * 1024;
+}
+
+void dlr_host_service_new(dlr_host_service_t **host_service, guint port,
+			  const dlr_renderer_settings_t *settings)
+{
+	dlr_host_service_t *hs;
+	gchar *cache_file;
+
+	hs = g_new(dlr_host_service_t, 1);
+	hs->servers = g_hash_table_new_full(g_str_hash, g_str_equal,
+					    g_free, prv_host_server_delete);
+	hs->probes = g_hash_table_new_full(g_str_hash, g_str_equal,
+					   NULL, prv_host_probe_delete);
+	hs->probe_pool = g_thread_pool_new(prv_host_probe_run, hs,
+					   DLR_HOST_SERVICE_MAX_PROBES,
+					   FALSE, NULL);
+
+	cache_file = g_build_filename(g_get_user_cache_dir(),
+				      "dleyna-renderer", "profiles", NULL);
+	hs->profiles = dlr_profile_cache_new(
+				cache_file,
+				DLR_HOST_SERVICE_PROFILE_CACHE_SIZE);
+	g_free(cache_file);
+
+	g_queue_init(&hs->mapped_files);
+	hs->mapped_bytes = 0;
+	hs->map_budget = (gsize)settings->push_host_map_cache_size << 20;
+	hs->map_hits = 0;
+	hs->map_misses = 0;
+
+	hs->read_pool = g_thread_pool_new(prv_host_stream_read, hs,
+					  DLR_HOST_SERVICE_MAX_READERS,
+					  FALSE, NULL);
+	hs->streams = g_hash_table_new(g_direct_hash, g_direct_equal);
+	hs->stream_threshold =
+		(goffset)settings->push_host_stream_threshold << 20;
+	hs->live_timeout = settings->push_host_live_timeout;
+
+	hs->max_rate = prv_kib_to_bytes(settings->push_host_max_rate);
+	hs->client_max_rate =
+		prv_kib_to_bytes(settings->push_host_client_max_rate);
+	hs->connection_max_rate =
+		prv_kib_to_bytes(settings->push_host_connection_max_rate);
+
+	/* Files handed to renderers on this machine as file:// URIs.  They
+	   are never served, but the clients that asked for them are
+	   tracked so that RemoveFile behaves as for hosted files. */
+
+	hs->local_file_uris = settings->push_host_local_file_uris;
+	hs->local_files = g_hash_table_new_full(
+					g_str_hash, g_str_equal, g_free,
+					(GDestroyNotify) g_hash_table_unref);
+	hs->clients = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+					    prv_host_client_delete);
+
+	hs->scale_images = settings->push_host_scale_images;
+	hs->image_cache_dir = g_build_filename(g_get_user_cache_dir(),
+					       "dleyna-renderer", "images",
+					       NULL);
+
+	hs->access_log = NULL;
+	if (settings->push_host_access_log)
+		hs->access_log = dlr_access_log_new(
+			settings->push_host_access_log,
+			(gsize)settings->push_host_access_log_max_size << 20,
+			settings->push_host_access_log_files);
+
+	/* The HTTP servers run on their own thread and main context so
+	   that serving files never delays D-Bus or UPnP processing. */
+
+	g_mutex_init(&hs->lock);
+	hs->retiring = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+					     NULL);
+	hs->context = g_main_context_new();
+	hs->loop = g_main_loop_new(hs->context, FALSE);
+	hs->thread = g_thread_new("dleyna-push-host", prv_host_thread, hs);
+
+	hs->port = port;
+
+	*host_service = hs;
+}
+
+static gboolean prv_fits_image_profile(dlr_host_service_t *host_service,
+				       dlr_host_file_t *hf,
+				       const dlr_image_profile_t *image_profile)
+{
+	gboolean retval = FALSE;
+
+	if (!hf)
+		goto on_exit;
+
+	/* Profiles are ordered from the smallest to the largest, and a
+	   photo that fits one profile fits all the larger ones. */
+
+	g_mutex_lock(&host_service->lock);
+	retval = hf->image_fit && hf->image_fit <= image_profile;
+	g_mutex_unlock(&host_service->lock);
+
+on_exit:
+
+	return retval;
+}
+
+static gchar *prv_image_key(const gchar *file,
+			    const dlr_image_profile_t *image_profile)
+{
+	return g_strdup_printf("%s#%s", file,
+			       dlr_image_profile_get_name(image_profile));
+}
+
+static void prv_host_probe_wait(dlr_host_probe_t *probe,
+				const gchar *device_if, const gchar *client,
+				gboolean live,
+				const dlr_image_profile_t *image_profile,
+				GCancellable *cancellable,
+				dlr_host_service_add_cb_t cb,
+				gpointer user_data)
+{
+	dlr_host_waiter_t *waiter;
+
+	if (live)
+		probe->live = TRUE;
+
+	waiter = g_new0(dlr_host_waiter_t, 1);
+	waiter->probe = probe;
+	waiter->device_if = g_strdup(device_if);
+	waiter->client = g_strdup(client);
+	waiter->live = live;
+	waiter->image_profile = image_profile;
+	waiter->cb = cb;
+	waiter->user_data = user_data;
+	g_ptr_array_add(probe->waiters, waiter);
+
+	if (cancellable) {
+		waiter->cancellable = g_object_ref(cancellable);
+		waiter->cancel_id = g_cancellable_connect(
+					cancellable,
+					G_CALLBACK(prv_host_waiter_cancelled),
+					waiter, NULL);
+	}
+}
+
+static gboolean prv_host_local_probe(dlr_host_service_t *host_service,
+				     const gchar *device_if,
+				     const gchar *client, const gchar *file,
+				     const dlr_image_profile_t *image_profile,
+				     GCancellable *cancellable,
+				     dlr_host_service_add_cb_t cb,
+				     gpointer user_data)
+{
+	dlr_host_probe_t *probe;
+	gchar *uri = NULL;
+	gboolean retval = FALSE;
+
+	if (!host_service->local_file_uris || !g_path_is_absolute(file))
+		goto on_exit;
+
+	uri = g_filename_to_uri(file, NULL, NULL);
+	if (!uri)
+		goto on_exit;
+
+	/* The probes are keyed by the URI, which cannot be mistaken for
+	   the path of a file being hosted. */
+
+	probe = g_hash_table_lookup(host_service->probes, uri);
+
+	if (!probe) {
+		probe = prv_host_probe_new(host_service, uri, file);
+		probe->local = TRUE;
+
+		g_hash_table_insert(host_service->probes, probe->key, probe);
+		(void) g_thread_pool_push(host_service->probe_pool, probe,
+					  NULL);
+	}
+
+	prv_host_probe_wait(probe, device_if, client, FALSE, image_profile,
+			    cancellable, cb, user_data);
+
+	retval = TRUE;
+
+on_exit:
+
+	g_free(uri);
+
+	return retval;
+}
+
+void dlr_host_service_add(dlr_host_service_t *host_service,
+			  const gchar *device_if, const gchar *client,
+			  const gchar *file, gboolean live, gboolean local,
+			  const dlr_image_profile_t *image_profile,
+			  GCancellable *cancellable,
+			  dlr_host_service_add_cb_t cb, gpointer user_data)
+{
+	dlr_host_server_t *server;
+	dlr_host_probe_t *probe;
+	gchar *url;
+	gchar *key = NULL;
+	GError *error = NULL;
+
+	if (cancellable && g_cancellable_is_cancelled(cancellable)) {
+		error = g_error_new(DLEYNA_SERVER_ERROR,
+				    DLEYNA_ERROR_CANCELLED,
+				    "Operation cancelled.");
+		goto on_error;
+	}
+
+	/* A renderer on this machine that can open the file itself is
+	   given a file URI, once the probe pool has checked that the file
+	   is a regular one. */
+
+	if (local &&
+	    prv_host_local_probe(host_service, device_if, client, file,
+				 image_profile, cancellable, cb, user_data))
+		goto on_exit;
+
+	/* A photo scaled down for a renderer is hosted under a key of its
+	   own, as renderers on the same interface may need different
+	   sizes. */
+
+	if (image_profile && !live && host_service->scale_images &&
+	    dlr_image_scaler_handles(file))
+		key = prv_image_key(file, image_profile);
+
+	server = g_hash_table_lookup(host_service->servers, device_if);
+
+	if (server && key && g_hash_table_lookup(server->files, key)) {
+		url = prv_add_new_file(server, client, device_if, key, NULL,
+				       FALSE);
+		cb(url, NULL, user_data);
+		g_free(url);
+
+		goto on_exit;
+	}
+
+	/* A photo that did not need scaling is hosted under its own name */
+
+	if (server && key &&
+	    prv_fits_image_profile(host_service,
+				   g_hash_table_lookup(server->files, file),
+				   image_profile)) {
+		url = prv_add_new_file(server, client, device_if, file, NULL,
+				       FALSE);
+		cb(url, NULL, user_data);
+		g_free(url);
+
+		goto on_exit;
+	}
+
+	if (server && !key && g_hash_table_lookup(server->files, file)) {
+		url = prv_add_new_file(server, client, device_if, file, NULL,
+				       live);
+		cb(url, NULL, user_data);
+		g_free(url);
+
+		goto on_exit;
+	}
+
+	/* Profiling a media file can take seconds so it is done on the
+	   probe pool, as is anything else that touches the file, even
+	   when its profile is cached.  Concurrent requests for the same
+	   file share a single probe. */
+
+	probe = g_hash_table_lookup(host_service->probes, key ? key : file);
+
+	if (!probe) {
+		DLEYNA_LOG_DEBUG("Probing %s", file);
+
+		probe = prv_host_probe_new(host_service, key ? key : file,
+					   file);
+		if (key)
+			probe->image_profile = image_profile;
+
+		g_hash_table_insert(host_service->probes, probe->key, probe);
+		(void) g_thread_pool_push(host_service->probe_pool, probe,
+					  NULL);
+	}
+
+	prv_host_probe_wait(probe, device_if, client, live, image_profile,
+			    cancellable, cb, user_data);
+
+	goto on_exit;
+
+on_error:
+
+	cb(NULL, error, user_data);
+	g_error_free(error);
+
+on_exit:
+
+	g_free(key);
+}
+
+static gboolean prv_remove_local_client(dlr_host_service_t *host_service,
+					const gchar *client,
+					const gchar *file)
+{
+	GHashTable *clients;
+	dlr_host_client_t *hc;
+	gboolean retval = FALSE;
+
+	clients = g_hash_table_lookup(host_service->local_files, file);
+
+	if (!clients || !g_hash_table_remove(clients, client))
+		goto on_error;
+
+	if (g_hash_table_size(clients) == 0)
+		g_hash_table_remove(host_service->local_files, file);
+
+	hc = g_hash_table_lookup(host_service->clients, client);
+	if (hc) {
+		(void) g_hash_table_remove(hc->local_files, file);
+		prv_release_client(host_service, client);
+	}
+
+	retval = TRUE;
+
+on_error:
+
+	return retval;
+}
+
+void dlr_host_service_prefetch(dlr_host_service_t *host_service,
+			       const gchar *url)
+{
+#ifdef HAVE_POSIX_FADVISE
+	SoupURI *uri;
+	dlr_host_server_t *server;
+	dlr_host_file_t *hf;
+	dlr_host_probe_t *probe = NULL;
+	const gchar *file_name;
+	goffset length;
+
+	uri = soup_uri_new(url);
+
+	if (!uri || uri->scheme != SOUP_URI_SCHEME_HTTP || !uri->host)
+		goto on_exit;
+
+	server = g_hash_table_lookup(host_service->servers, uri->host);
+
+	if (!server || prv_host_server_get_port(server) != uri->port)
+		goto on_exit;
+
+	/* The file is already being read ahead */
+
+	if (g_hash_table_contains(host_service->probes, url))
+		goto on_exit;
+
+	g_mutex_lock(&host_service->lock);
+
+	/* The lock is only held to look the file up.  It is opened and
+	   read ahead on the probe pool, so that a slow file system never
+	   holds up the main thread. */
+
+	hf = prv_host_server_find_file(server, uri->path, &file_name);
+
+	if (hf && !hf->live) {
+		probe = prv_host_probe_new(host_service, url, file_name);
+		probe->read_ahead = hf->size;
+	}
+
+	g_mutex_unlock(&host_service->lock);
+
+	if (!probe)
+		goto on_exit;
+
+	/* Only the start of large files is read, which is all the renderer
+	   needs to begin playing. */
+
+	length = probe->read_ahead;
+	if (length <= 0 || length > DLR_HOST_SERVICE_READAHEAD_SIZE)
+		length = DLR_HOST_SERVICE_READAHEAD_SIZE;
+	probe->read_ahead = length;
+
+	DLEYNA_LOG_DEBUG("Reading ahead %"G_GOFFSET_FORMAT" bytes of %s",
+			 length, url);
+
+	/* Read aheads are tracked like probes, under their URL, so that
+	   those still queued are freed with the other probes. */
+
+	g_hash_table_insert(host_service->probes, probe->key, probe);
+	(void) g_thread_pool_push(host_service->probe_pool, probe, NULL);
+
+on_exit:
+
+	if (uri)
+		soup_uri_free(uri);
+#endif
+}
+
+gboolean dlr_host_service_remove(dlr_host_service_t *host_service,
+				 const gchar *device_if, const gchar *client,
+				 const gchar *file,
+				 const dlr_image_profile_t *image_profile)
+{
+	gboolean retval = FALSE;
+	dlr_host_file_t *hf = NULL;
+	dlr_host_server_t *server;
+	gchar *image_key = NULL;
+
+	server = g_hash_table_lookup(host_service->servers, device_if);
+
+	/* The file may have been scaled for the renderer */
+
+	if (server && image_profile) {
+		image_key = prv_image_key(file, image_profile);
+		hf = g_hash_table_lookup(server->files, image_key);
+	}
+
+	if (server && !hf)
+		hf = g_hash_table_lookup(server->files, file);
+
+	if (!hf) {
+		retval = prv_remove_local_client(host_service, client, file);
+		goto on_error;
+	}
+
+	retval = prv_remove_client(host_service, client, hf);
+	if (retval)
+		prv_unhost_file(host_service, hf);
+
+on_error:
+
+	g_free(image_key);
+
+	return retval;
+}
+
+void dlr_host_service_lost_client(dlr_host_service_t *host_service,
+				  const gchar *client)
+{
+	GHashTableIter iter;
+	gpointer key;
+	dlr_host_client_t *hc;
+	dlr_host_file_t *hf;
+	GHashTable *clients;
+
+	hc = g_hash_table_lookup(host_service->clients, client);
+	if (!hc)
+		goto on_exit;
+
+	g_hash_table_iter_init(&iter, hc->local_files);
+
+	while (g_hash_table_iter_next(&iter, &key, NULL)) {
+		clients = g_hash_table_lookup(host_service->local_files, key);
+
+		if (clients && g_hash_table_remove(clients, client) &&
+		    g_hash_table_size(clients) == 0)
+			g_hash_table_remove(host_service->local_files, key);
+	}
+
+	/* The set only holds pointers, so a file that is freed once its
+	   last client has gone does not disturb the walk. */
+
+	g_hash_table_iter_init(&iter, hc->files);
+
+	while (g_hash_table_iter_next(&iter, &key, NULL)) {
+		hf = key;
+
+		if (g_hash_table_remove(hf->clients, client))
+			prv_unhost_file(host_service, hf);
+	}
+
+	g_hash_table_remove(host_service->clients, client);
+
+on_exit:
+
+	return;
+}
+
+GVariant *dlr_host_service_get_stats(dlr_host_service_t *host_service,
+				     const gchar *device_if)
+{
+	GVariantBuilder vb;
+	dlr_host_server_t *server;
+	dlr_host_stats_t stats;
+	guint64 throughput = 0;
+
+	memset(&stats, 0, sizeof(stats));
+
+	server = g_hash_table_lookup(host_service->servers, device_if);
+
+	if (server) {
+		g_mutex_lock(&host_service->lock);
+		stats = server->stats;
+		g_mutex_unlock(&host_service->lock);
+	}
+
+	/* The throughput is averaged over the time spent on finished
+	   transfers, so idle periods do not bring it down. */
+
+	if (stats.transfer_time > 0)
+		throughput = stats.bytes_sent * G_USEC_PER_SEC /
+			stats.transfer_time;
+
+	g_variant_builder_init(&vb, G_VARIANT_TYPE("a{sv}"));
+	g_variant_builder_add(&vb, "{sv}", DLR_INTERFACE_PROP_REQUESTS,
+			      g_variant_new_uint64(stats.requests));
+	g_variant_builder_add(&vb, "{sv}", DLR_INTERFACE_PROP_BYTES_SENT,
+			      g_variant_new_uint64(stats.bytes_sent));
+	g_variant_builder_add(&vb, "{sv}",
+			      DLR_INTERFACE_PROP_ACTIVE_TRANSFERS,
+			      g_variant_new_uint32(stats.active));
+	g_variant_builder_add(&vb, "{sv}",
+			      DLR_INTERFACE_PROP_COMPLETED_TRANSFERS,
+			      g_variant_new_uint64(stats.completed));
+	g_variant_builder_add(&vb, "{sv}",
+			      DLR_INTERFACE_PROP_ABORTED_TRANSFERS,
+			      g_variant_new_uint64(stats.aborted));
+	g_variant_builder_add(&vb, "{sv}", DLR_INTERFACE_PROP_THROUGHPUT,
+			      g_variant_new_uint64(throughput));
+
+	return g_variant_builder_end(&vb);
+}
+
+void dlr_host_service_delete(dlr_host_service_t *host_service)
 {
 	if (host_service) {
+		/* Queued probes are dropped but we need to wait for those
+		   that are running as they still reference their probe. */
+		g_thread_pool_free(host_service->probe_pool, TRUE, TRUE);
+		g_hash_table_unref(host_service->probes);
+		dlr_profile_cache_delete(host_service->profiles);
+
+		/* The servers are destroyed on the host thread, which is
+		   then asked to stop. */
+
 		g_hash_table_unref(host_service->servers);
+		g_main_context_invoke(host_service->context,
+				      prv_host_thread_quit_cb, host_service);
+		g_thread_join(host_service->thread);
+
+		g_hash_table_unref(host_service->streams);
+		g_hash_table_unref(host_service->local_files);
+		g_hash_table_unref(host_service->clients);
+		g_free(host_service->image_cache_dir);
+		dlr_access_log_delete(host_service->access_log);
+		g_main_loop_unref(host_service->loop);
+		g_main_context_unref(host_service->context);
+		g_mutex_clear(&host_service->lock);
+		g_hash_table_unref(host_service->retiring);
 		g_free(host_service);
 	}
 }
@@ -23,22 +23,39 @@
 #ifndef DLR_HOST_SERVICE_H__
 #define DLR_HOST_SERVICE_H__
 
+#include "image-scaler.h"
+#include "renderer-settings.h"
+
 typedef struct dlr_host_service_t_ dlr_host_service_t;
 
-void dlr_host_service_new(dlr_host_service_t **host_service,
-			  guint port);
+typedef void (*dlr_host_service_add_cb_t)(const gchar *url,
+					  const GError *error,
+					  gpointer user_data);
+
+void dlr_host_service_new(dlr_host_service_t **host_service, guint port,
+			  const dlr_renderer_settings_t *settings);
 
-gchar *dlr_host_service_add(dlr_host_service_t *host_service,
-			    const gchar *device_if, const gchar *client,
-			    const gchar *file, GError **error);
+void dlr_host_service_add(dlr_host_service_t *host_service,
+			  const gchar *device_if, const gchar *client,
+			  const gchar *file, gboolean live, gboolean local,
+			  const dlr_image_profile_t *image_profile,
+			  GCancellable *cancellable,
+			  dlr_host_service_add_cb_t cb, gpointer user_data);
+
+void dlr_host_service_prefetch(dlr_host_service_t *host_service,
+			       const gchar *url);
 
 gboolean dlr_host_service_remove(dlr_host_service_t *host_service,
 				 const gchar *device_if, const gchar *client,
-				 const gchar *file);
+				 const gchar *file,
+				 const dlr_image_profile_t *image_profile);
 
 void dlr_host_service_lost_client(dlr_host_service_t *host_service,
 				  const gchar *client);
 
+GVariant *dlr_host_service_get_stats(dlr_host_service_t *host_service,
+				     const gchar *device_if);
+
 void dlr_host_service_delete(dlr_host_service_t *host_service);
 
 #endif /*DLR_HOST_SERVICE_H__ */
@@ -0,0 +1,368 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#ifdef HAVE_GDK_PIXBUF
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#endif
+
+#include <libdleyna/core/log.h>
+
+#include "image-scaler.h"
+
+#define DLR_IMAGE_SCALER_QUALITY "85"
+#define DLR_IMAGE_SCALER_CACHE_SIZE (128 * 1024 * 1024)
+
+struct dlr_image_profile_t_ {
+	const gchar *name;
+	guint width;
+	guint height;
+};
+
+/* The DLNA JPEG profiles, from the smallest to the largest.  Their
+   limits apply to portrait images as well as to landscape ones. */
+
+static const dlr_image_profile_t g_profiles[] = {
+	{ "JPEG_TN", 160, 160 },
+	{ "JPEG_SM", 640, 480 },
+	{ "JPEG_MED", 1024, 768 },
+	{ "JPEG_LRG", 4096, 4096 }
+};
+
+static const dlr_image_profile_t *prv_lookup_profile(const gchar *name,
+						     gsize length)
+{
+	const dlr_image_profile_t *retval = NULL;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(g_profiles); ++i) {
+		if (strlen(g_profiles[i].name) == length &&
+		    !strncmp(g_profiles[i].name, name, length)) {
+			retval = &g_profiles[i];
+			break;
+		}
+	}
+
+	return retval;
+}
+
+const dlr_image_profile_t *dlr_image_profile_from_protocol_info(
+						const gchar *protocol_info)
+{
+	const dlr_image_profile_t *retval = NULL;
+	const dlr_image_profile_t *profile;
+	gboolean unrestricted = FALSE;
+	gchar **entries;
+	gchar **fields;
+	const gchar *pn;
+	guint i;
+
+	/* The largest JPEG profile the renderer accepts over HTTP is the
+	   limit.  An entry that names no profile accepts any JPEG, and
+	   profiles we do not know about are ignored. */
+
+	entries = g_strsplit(protocol_info, ",", 0);
+
+	for (i = 0; entries[i] && !unrestricted; ++i) {
+		fields = g_strsplit(entries[i], ":", 4);
+
+		if (fields[0] && fields[1] && fields[2] && fields[3] &&
+		    !g_ascii_strcasecmp(g_strstrip(fields[0]), "http-get") &&
+		    !g_ascii_strcasecmp(fields[2], "image/jpeg")) {
+			pn = strstr(fields[3], "DLNA.ORG_PN=");
+
+			if (pn) {
+				pn += strlen("DLNA.ORG_PN=");
+				profile = prv_lookup_profile(pn,
+							     strcspn(pn, ";"));
+				if (profile && (!retval || profile > retval))
+					retval = profile;
+			} else {
+				unrestricted = TRUE;
+			}
+		}
+
+		g_strfreev(fields);
+	}
+
+	g_strfreev(entries);
+
+	return unrestricted ? NULL : retval;
+}
+
+const gchar *dlr_image_profile_get_name(const dlr_image_profile_t *profile)
+{
+	return profile->name;
+}
+
+gboolean dlr_image_scaler_handles(const gchar *file)
+{
+	gboolean retval = FALSE;
+#ifdef HAVE_GDK_PIXBUF
+	gchar *content_type;
+
+	content_type = g_content_type_guess(file, NULL, 0, NULL);
+	retval = content_type && g_content_type_is_a(content_type,
+						     "image/jpeg");
+	g_free(content_type);
+#endif
+
+	return retval;
+}
+
+#ifdef HAVE_GDK_PIXBUF
+static gboolean prv_fit(const dlr_image_profile_t *profile,
+			gint width, gint height,
+			gint *fit_width, gint *fit_height)
+{
+	guint long_side = MAX(width, height);
+	guint short_side = MIN(width, height);
+	guint max_long_side = MAX(profile->width, profile->height);
+	guint max_short_side = MIN(profile->width, profile->height);
+	gdouble scale;
+
+	if (long_side <= max_long_side && short_side <= max_short_side)
+		return FALSE;
+
+	scale = MIN((gdouble)max_long_side / long_side,
+		    (gdouble)max_short_side / short_side);
+
+	*fit_width = MAX((gint)(width * scale), 1);
+	*fit_height = MAX((gint)(height * scale), 1);
+
+	return TRUE;
+}
+#endif
+
+#ifdef HAVE_GDK_PIXBUF
+typedef struct dlr_image_copy_t_ dlr_image_copy_t;
+struct dlr_image_copy_t_ {
+	gchar *path;
+	gint64 size;
+	gint64 mtime;
+};
+
+G_LOCK_DEFINE_STATIC(cache);
+
+static void prv_image_copy_delete(gpointer image_copy)
+{
+	dlr_image_copy_t *copy = image_copy;
+
+	if (copy) {
+		g_free(copy->path);
+		g_free(copy);
+	}
+}
+
+static gint prv_compare_copies(gconstpointer a, gconstpointer b)
+{
+	const dlr_image_copy_t *copy_a = *(dlr_image_copy_t **) a;
+	const dlr_image_copy_t *copy_b = *(dlr_image_copy_t **) b;
+
+	return (copy_a->mtime > copy_b->mtime) -
+		(copy_a->mtime < copy_b->mtime);
+}
+
+static void prv_trim_cache(const gchar *cache_dir)
+{
+	GDir *dir;
+	const gchar *name;
+	GPtrArray *copies;
+	dlr_image_copy_t *copy;
+	GStatBuf buf;
+	gchar *path;
+	gint64 total = 0;
+	guint i;
+
+	/* The modification time of a copy is that of its last use, so
+	   the least recently used copies are removed first once the
+	   cache has outgrown its size. */
+
+	G_LOCK(cache);
+
+	copies = g_ptr_array_new_with_free_func(prv_image_copy_delete);
+
+	dir = g_dir_open(cache_dir, 0, NULL);
+	if (!dir)
+		goto on_exit;
+
+	while ((name = g_dir_read_name(dir))) {
+		if (!g_str_has_suffix(name, ".jpg"))
+			continue;
+
+		path = g_build_filename(cache_dir, name, NULL);
+
+		if (g_stat(path, &buf) != 0) {
+			g_free(path);
+			continue;
+		}
+
+		copy = g_new0(dlr_image_copy_t, 1);
+		copy->path = path;
+		copy->size = buf.st_size;
+		copy->mtime = buf.st_mtime;
+		g_ptr_array_add(copies, copy);
+
+		total += copy->size;
+	}
+
+	g_dir_close(dir);
+
+	g_ptr_array_sort(copies, prv_compare_copies);
+
+	for (i = 0; i < copies->len && total > DLR_IMAGE_SCALER_CACHE_SIZE;
+	     ++i) {
+		copy = g_ptr_array_index(copies, i);
+
+		DLEYNA_LOG_DEBUG("Removing scaled copy %s", copy->path);
+
+		(void) g_unlink(copy->path);
+		total -= copy->size;
+	}
+
+on_exit:
+
+	g_ptr_array_unref(copies);
+
+	G_UNLOCK(cache);
+}
+#endif
+
+gchar *dlr_image_scaler_scale(const gchar *file,
+			      const dlr_image_profile_t *profile,
+			      const gchar *cache_dir)
+{
+	gchar *retval = NULL;
+#ifdef HAVE_GDK_PIXBUF
+	GdkPixbufFormat *format;
+	GdkPixbuf *pixbuf = NULL;
+	GdkPixbuf *oriented = NULL;
+	GStatBuf source_buf;
+	GStatBuf buf;
+	GError *error = NULL;
+	gchar *format_name = NULL;
+	gchar *checksum = NULL;
+	gchar *name;
+	gchar *path = NULL;
+	gchar *tmp_path = NULL;
+	gint width;
+	gint height;
+	gint fit_width;
+	gint fit_height;
+
+	format = gdk_pixbuf_get_file_info(file, &width, &height);
+	if (format)
+		format_name = gdk_pixbuf_format_get_name(format);
+
+	if (!format_name || strcmp(format_name, "jpeg") ||
+	    width <= 0 || height <= 0 ||
+	    !prv_fit(profile, width, height, &fit_width, &fit_height))
+		goto on_exit;
+
+	if (g_stat(file, &source_buf) != 0)
+		goto on_exit;
+
+	/* Copies are cached by source file and profile.  One made since
+	   the source was last modified is still good, and is touched to
+	   record its use. */
+
+	checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, file, -1);
+	name = g_strdup_printf("%s-%s.jpg", checksum, profile->name);
+	path = g_build_filename(cache_dir, name, NULL);
+	g_free(name);
+
+	if (g_stat(path, &buf) == 0 && buf.st_mtime >= source_buf.st_mtime) {
+		(void) g_utime(path, NULL);
+		retval = path;
+		path = NULL;
+		goto on_exit;
+	}
+
+	if (g_mkdir_with_parents(cache_dir, 0700) != 0) {
+		DLEYNA_LOG_WARNING("Unable to create %s: %s", cache_dir,
+				   g_strerror(errno));
+		goto on_exit;
+	}
+
+	/* The JPEG decoder scales down as it decodes, which is much faster
+	   than decoding the full image first. */
+
+	pixbuf = gdk_pixbuf_new_from_file_at_size(file, fit_width, fit_height,
+						  &error);
+	if (!pixbuf)
+		goto on_error;
+
+	/* The EXIF data is not carried over, so the orientation it gives
+	   is applied to the pixels instead. */
+
+	oriented = gdk_pixbuf_apply_embedded_orientation(pixbuf);
+
+	tmp_path = g_strdup_printf("%s.tmp", path);
+
+	if (!gdk_pixbuf_save(oriented, tmp_path, "jpeg", &error,
+			     "quality", DLR_IMAGE_SCALER_QUALITY, NULL))
+		goto on_error;
+
+	if (g_rename(tmp_path, path) != 0) {
+		DLEYNA_LOG_WARNING("Unable to rename %s: %s", tmp_path,
+				   g_strerror(errno));
+		(void) g_unlink(tmp_path);
+		goto on_exit;
+	}
+
+	DLEYNA_LOG_DEBUG("Scaled %s from %dx%d to %dx%d for %s", file,
+			 width, height, fit_width, fit_height, profile->name);
+
+	prv_trim_cache(cache_dir);
+
+	retval = path;
+	path = NULL;
+
+	goto on_exit;
+
+on_error:
+
+	DLEYNA_LOG_WARNING("Unable to scale %s: %s", file, error->message);
+	g_error_free(error);
+
+	if (tmp_path)
+		(void) g_unlink(tmp_path);
+
+on_exit:
+
+	if (oriented)
+		g_object_unref(oriented);
+
+	if (pixbuf)
+		g_object_unref(pixbuf);
+
+	g_free(tmp_path);
+	g_free(path);
+	g_free(checksum);
+	g_free(format_name);
+#endif
+
+	return retval;
+}
@@ -0,0 +1,39 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef DLR_IMAGE_SCALER_H__
+#define DLR_IMAGE_SCALER_H__
+
+#include <glib.h>
+
+typedef struct dlr_image_profile_t_ dlr_image_profile_t;
+
+const dlr_image_profile_t *dlr_image_profile_from_protocol_info(
+						const gchar *protocol_info);
+
+const gchar *dlr_image_profile_get_name(const dlr_image_profile_t *profile);
+
+gboolean dlr_image_scaler_handles(const gchar *file);
+
+gchar *dlr_image_scaler_scale(const gchar *file,
+			      const dlr_image_profile_t *profile,
+			      const gchar *cache_dir);
+
+#endif /* DLR_IMAGE_SCALER_H__ */
@@ -0,0 +1,282 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <string.h>
+#include <glib.h>
+
+#include "last-change.h"
+
+/* Extracts the values of a fixed set of variables from LastChange
+   events.  The document is parsed as a stream, without building a tree,
+   and the values are copied into buffers that are reused from one event
+   to the next. */
+
+typedef struct dlr_last_change_value_t_ dlr_last_change_value_t;
+struct dlr_last_change_value_t_ {
+	gchar *name;
+	GString *val;
+	gboolean found;
+};
+
+struct dlr_last_change_t_ {
+	dlr_last_change_value_t *values;
+	guint count;
+	guint instance_id;
+	guint depth;
+	guint instance_depth;
+	gboolean instance_found;
+	gboolean done;
+};
+
+static const gchar *prv_local_name(const gchar *element_name)
+{
+	const gchar *colon = strchr(element_name, ':');
+
+	return colon ? colon + 1 : element_name;
+}
+
+static const gchar *prv_get_attribute(const gchar **attribute_names,
+				      const gchar **attribute_values,
+				      const gchar *name)
+{
+	guint i;
+
+	for (i = 0; attribute_names[i]; ++i)
+		if (!strcmp(prv_local_name(attribute_names[i]), name))
+			return attribute_values[i];
+
+	return NULL;
+}
+
+static gboolean prv_parse_uint(const gchar *str, guint *value)
+{
+	guint64 number;
+	gchar *end;
+
+	number = g_ascii_strtoull(str, &end, 10);
+
+	if (end == str || *end || number > G_MAXUINT)
+		return FALSE;
+
+	*value = (guint) number;
+
+	return TRUE;
+}
+
+static gboolean prv_parse_bool(const gchar *str, gboolean *value)
+{
+	/* UPnP booleans may be given as numbers, words or yes/no */
+
+	if (!strcmp(str, "1") || !g_ascii_strcasecmp(str, "true") ||
+	    !g_ascii_strcasecmp(str, "yes"))
+		*value = TRUE;
+	else if (!strcmp(str, "0") || !g_ascii_strcasecmp(str, "false") ||
+		 !g_ascii_strcasecmp(str, "no"))
+		*value = FALSE;
+	else
+		return FALSE;
+
+	return TRUE;
+}
+
+static void prv_start_element(GMarkupParseContext *context,
+			      const gchar *element_name,
+			      const gchar **attribute_names,
+			      const gchar **attribute_values,
+			      gpointer user_data,
+			      GError **error)
+{
+	dlr_last_change_t *lc = user_data;
+	const gchar *name = prv_local_name(element_name);
+	const gchar *val;
+	const gchar *channel;
+	guint id;
+	guint i;
+
+	lc->depth++;
+
+	if (!lc->instance_depth) {
+		if (strcmp(name, "InstanceID"))
+			goto on_exit;
+
+		val = prv_get_attribute(attribute_names, attribute_values,
+					"val");
+
+		if (val && prv_parse_uint(val, &id) && id == lc->instance_id) {
+			lc->instance_depth = lc->depth;
+			lc->instance_found = TRUE;
+		}
+
+		goto on_exit;
+	}
+
+	if (lc->depth != lc->instance_depth + 1)
+		goto on_exit;
+
+	for (i = 0; i < lc->count; ++i)
+		if (!strcmp(lc->values[i].name, name))
+			break;
+
+	if (i == lc->count)
+		goto on_exit;
+
+	/* Variables with a value per channel, such as Volume, are only
+	   followed for the master channel. */
+
+	channel = prv_get_attribute(attribute_names, attribute_values,
+				    "channel");
+	if (channel && strcmp(channel, "Master"))
+		goto on_exit;
+
+	val = prv_get_attribute(attribute_names, attribute_values, "val");
+	if (!val)
+		goto on_exit;
+
+	g_string_assign(lc->values[i].val, val);
+	lc->values[i].found = TRUE;
+
+on_exit:
+
+	return;
+}
+
+static void prv_end_element(GMarkupParseContext *context,
+			    const gchar *element_name,
+			    gpointer user_data,
+			    GError **error)
+{
+	dlr_last_change_t *lc = user_data;
+
+	/* Nothing after our instance is of interest, so parsing stops
+	   there.  GMarkup can only be stopped by raising an error. */
+
+	if (lc->instance_depth && lc->depth == lc->instance_depth) {
+		lc->done = TRUE;
+		g_set_error_literal(error, G_MARKUP_ERROR,
+				    G_MARKUP_ERROR_INVALID_CONTENT,
+				    "Instance parsed");
+	}
+
+	lc->depth--;
+}
+
+static const GMarkupParser g_last_change_parser = {
+	prv_start_element,
+	prv_end_element,
+	NULL,
+	NULL,
+	NULL
+};
+
+dlr_last_change_t *dlr_last_change_new(const gchar *const *variables)
+{
+	dlr_last_change_t *lc;
+	guint i;
+
+	lc = g_new0(dlr_last_change_t, 1);
+	lc->count = g_strv_length((gchar **)variables);
+	lc->values = g_new0(dlr_last_change_value_t, lc->count);
+
+	for (i = 0; i < lc->count; ++i) {
+		lc->values[i].name = g_strdup(variables[i]);
+		lc->values[i].val = g_string_new(NULL);
+	}
+
+	return lc;
+}
+
+gboolean dlr_last_change_parse(dlr_last_change_t *last_change,
+			       const gchar *xml, guint instance_id)
+{
+	GMarkupParseContext *context;
+	GError *error = NULL;
+	gboolean retval;
+	guint i;
+
+	for (i = 0; i < last_change->count; ++i)
+		last_change->values[i].found = FALSE;
+
+	last_change->instance_id = instance_id;
+	last_change->depth = 0;
+	last_change->instance_depth = 0;
+	last_change->instance_found = FALSE;
+	last_change->done = FALSE;
+
+	if (!xml)
+		return FALSE;
+
+	context = g_markup_parse_context_new(&g_last_change_parser, 0,
+					     last_change, NULL);
+
+	retval = g_markup_parse_context_parse(context, xml, -1, &error) &&
+		g_markup_parse_context_end_parse(context, &error);
+
+	g_markup_parse_context_free(context);
+
+	if (error)
+		g_error_free(error);
+
+	/* A document that is malformed after our instance is accepted, as
+	   it was never read that far. */
+
+	if (last_change->done)
+		retval = TRUE;
+
+	return retval && last_change->instance_found;
+}
+
+const gchar *dlr_last_change_get_string(dlr_last_change_t *last_change,
+					guint variable)
+{
+	dlr_last_change_value_t *value = &last_change->values[variable];
+
+	return value->found ? value->val->str : NULL;
+}
+
+gboolean dlr_last_change_get_uint(dlr_last_change_t *last_change,
+				  guint variable, guint *value)
+{
+	const gchar *str = dlr_last_change_get_string(last_change, variable);
+
+	return str && prv_parse_uint(str, value);
+}
+
+gboolean dlr_last_change_get_bool(dlr_last_change_t *last_change,
+				  guint variable, gboolean *value)
+{
+	const gchar *str = dlr_last_change_get_string(last_change, variable);
+
+	return str && prv_parse_bool(str, value);
+}
+
+void dlr_last_change_delete(dlr_last_change_t *last_change)
+{
+	guint i;
+
+	if (last_change) {
+		for (i = 0; i < last_change->count; ++i) {
+			g_free(last_change->values[i].name);
+			(void) g_string_free(last_change->values[i].val, TRUE);
+		}
+
+		g_free(last_change->values);
+		g_free(last_change);
+	}
+}
@@ -0,0 +1,44 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef DLR_LAST_CHANGE_H__
+#define DLR_LAST_CHANGE_H__
+
+#include <glib.h>
+
+typedef struct dlr_last_change_t_ dlr_last_change_t;
+
+dlr_last_change_t *dlr_last_change_new(const gchar *const *variables);
+
+gboolean dlr_last_change_parse(dlr_last_change_t *last_change,
+			       const gchar *xml, guint instance_id);
+
+const gchar *dlr_last_change_get_string(dlr_last_change_t *last_change,
+					guint variable);
+
+gboolean dlr_last_change_get_uint(dlr_last_change_t *last_change,
+				  guint variable, guint *value);
+
+gboolean dlr_last_change_get_bool(dlr_last_change_t *last_change,
+				  guint variable, gboolean *value);
+
+void dlr_last_change_delete(dlr_last_change_t *last_change);
+
+#endif /* DLR_LAST_CHANGE_H__ */
@@ -0,0 +1,407 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libdleyna/core/log.h>
+
+#include "profile-cache.h"
+
+#define DLR_PROFILE_CACHE_SAVE_DELAY 5
+
+#define DLR_PROFILE_CACHE_KEY_PATH "Path"
+#define DLR_PROFILE_CACHE_KEY_INODE "Inode"
+#define DLR_PROFILE_CACHE_KEY_SIZE "Size"
+#define DLR_PROFILE_CACHE_KEY_MTIME "MTime"
+#define DLR_PROFILE_CACHE_KEY_MIME_TYPE "MimeType"
+#define DLR_PROFILE_CACHE_KEY_DLNA_HEADER "DLNAHeader"
+#define DLR_PROFILE_CACHE_KEY_SEEK_INDEX "SeekIndex"
+
+typedef struct dlr_profile_entry_t_ dlr_profile_entry_t;
+struct dlr_profile_entry_t_ {
+	gchar *path;
+	dlr_profile_cache_stamp_t stamp;
+	gchar *mime_type;
+	gchar *dlna_header;
+	gchar *seek_index;
+	GList *link;
+};
+
+struct dlr_profile_cache_t_ {
+	gchar *cache_file;
+	guint max_entries;
+	GHashTable *entries;
+	GQueue lru;
+	guint save_id;
+	GThreadPool *save_pool;
+	GMutex lock;
+};
+
+static void prv_entry_delete(gpointer profile_entry)
+{
+	dlr_profile_entry_t *entry = profile_entry;
+
+	if (entry) {
+		g_free(entry->path);
+		g_free(entry->mime_type);
+		g_free(entry->dlna_header);
+		g_free(entry->seek_index);
+		g_free(entry);
+	}
+}
+
+static dlr_profile_entry_t *prv_entry_copy(const dlr_profile_entry_t *entry)
+{
+	dlr_profile_entry_t *copy;
+
+	copy = g_new0(dlr_profile_entry_t, 1);
+	copy->path = g_strdup(entry->path);
+	copy->stamp = entry->stamp;
+	copy->mime_type = g_strdup(entry->mime_type);
+	copy->dlna_header = g_strdup(entry->dlna_header);
+	copy->seek_index = g_strdup(entry->seek_index);
+
+	return copy;
+}
+
+static void prv_remove_entry(dlr_profile_cache_t *cache,
+			     dlr_profile_entry_t *entry)
+{
+	g_queue_delete_link(&cache->lru, entry->link);
+	(void) g_hash_table_remove(cache->entries, entry->path);
+}
+
+static void prv_add_entry(dlr_profile_cache_t *cache,
+			  dlr_profile_entry_t *entry)
+{
+	dlr_profile_entry_t *old_entry;
+
+	old_entry = g_hash_table_lookup(cache->entries, entry->path);
+	if (old_entry)
+		prv_remove_entry(cache, old_entry);
+
+	g_queue_push_tail(&cache->lru, entry);
+	entry->link = g_queue_peek_tail_link(&cache->lru);
+	g_hash_table_insert(cache->entries, entry->path, entry);
+
+	/* The head of the queue is the least recently used entry */
+
+	while (g_hash_table_size(cache->entries) > cache->max_entries)
+		prv_remove_entry(cache, g_queue_peek_head(&cache->lru));
+}
+
+static void prv_load(dlr_profile_cache_t *cache)
+{
+	GKeyFile *key_file;
+	GError *error = NULL;
+	gchar **groups;
+	gsize length;
+	gsize i;
+	dlr_profile_entry_t *entry;
+
+	key_file = g_key_file_new();
+
+	if (!g_key_file_load_from_file(key_file, cache->cache_file,
+				       G_KEY_FILE_NONE, &error)) {
+		if (!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			DLEYNA_LOG_WARNING("Unable to load %s: %s",
+					   cache->cache_file, error->message);
+
+		g_error_free(error);
+		goto on_exit;
+	}
+
+	groups = g_key_file_get_groups(key_file, &length);
+
+	for (i = 0; i < length; ++i) {
+		entry = g_new0(dlr_profile_entry_t, 1);
+
+		entry->path = g_key_file_get_string(
+					key_file, groups[i],
+					DLR_PROFILE_CACHE_KEY_PATH, NULL);
+		entry->mime_type = g_key_file_get_string(
+					key_file, groups[i],
+					DLR_PROFILE_CACHE_KEY_MIME_TYPE, NULL);
+		entry->dlna_header = g_key_file_get_string(
+					key_file, groups[i],
+					DLR_PROFILE_CACHE_KEY_DLNA_HEADER, NULL);
+		entry->seek_index = g_key_file_get_string(
+					key_file, groups[i],
+					DLR_PROFILE_CACHE_KEY_SEEK_INDEX, NULL);
+		entry->stamp.inode = g_key_file_get_uint64(
+					key_file, groups[i],
+					DLR_PROFILE_CACHE_KEY_INODE, NULL);
+		entry->stamp.size = g_key_file_get_int64(
+					key_file, groups[i],
+					DLR_PROFILE_CACHE_KEY_SIZE, NULL);
+		entry->stamp.mtime = g_key_file_get_int64(
+					key_file, groups[i],
+					DLR_PROFILE_CACHE_KEY_MTIME, NULL);
+
+		/* Entries saved before seek indexes were added are dropped
+		   so that their files get indexed. */
+
+		if (!entry->path || !entry->mime_type || !entry->dlna_header ||
+		    !entry->seek_index) {
+			prv_entry_delete(entry);
+			continue;
+		}
+
+		prv_add_entry(cache, entry);
+	}
+
+	g_strfreev(groups);
+
+	DLEYNA_LOG_DEBUG("Loaded %u profiles from %s",
+			 g_hash_table_size(cache->entries), cache->cache_file);
+
+on_exit:
+
+	g_key_file_free(key_file);
+}
+
+static void prv_save_run(gpointer snapshot, gpointer user_data)
+{
+	GPtrArray *entries = snapshot;
+	dlr_profile_cache_t *cache = user_data;
+	GKeyFile *key_file;
+	GError *error = NULL;
+	dlr_profile_entry_t *entry;
+	gchar *group;
+	gchar *data;
+	gsize length;
+	gchar *dir;
+	guint i;
+
+	key_file = g_key_file_new();
+
+	/* Entries are written from least to most recently used so that
+	   the order of the queue survives a restart. */
+
+	for (i = 0; i < entries->len; ++i) {
+		entry = g_ptr_array_index(entries, i);
+		group = g_compute_checksum_for_string(G_CHECKSUM_MD5,
+						      entry->path, -1);
+
+		g_key_file_set_string(key_file, group,
+				      DLR_PROFILE_CACHE_KEY_PATH, entry->path);
+		g_key_file_set_uint64(key_file, group,
+				      DLR_PROFILE_CACHE_KEY_INODE,
+				      entry->stamp.inode);
+		g_key_file_set_int64(key_file, group,
+				     DLR_PROFILE_CACHE_KEY_SIZE,
+				     entry->stamp.size);
+		g_key_file_set_int64(key_file, group,
+				     DLR_PROFILE_CACHE_KEY_MTIME,
+				     entry->stamp.mtime);
+		g_key_file_set_string(key_file, group,
+				      DLR_PROFILE_CACHE_KEY_MIME_TYPE,
+				      entry->mime_type);
+		g_key_file_set_string(key_file, group,
+				      DLR_PROFILE_CACHE_KEY_DLNA_HEADER,
+				      entry->dlna_header);
+		g_key_file_set_string(key_file, group,
+				      DLR_PROFILE_CACHE_KEY_SEEK_INDEX,
+				      entry->seek_index);
+
+		g_free(group);
+	}
+
+	data = g_key_file_to_data(key_file, &length, NULL);
+
+	dir = g_path_get_dirname(cache->cache_file);
+	(void) g_mkdir_with_parents(dir, 0700);
+	g_free(dir);
+
+	if (!g_file_set_contents(cache->cache_file, data, length, &error)) {
+		DLEYNA_LOG_WARNING("Unable to save %s: %s",
+				   cache->cache_file, error->message);
+		g_error_free(error);
+	}
+
+	g_free(data);
+	g_key_file_free(key_file);
+	g_ptr_array_unref(entries);
+}
+
+static void prv_save(dlr_profile_cache_t *cache)
+{
+	GPtrArray *entries;
+	GList *link;
+
+	/* Only a copy of the entries is taken under the lock.  They are
+	   serialized and written by the save thread, which writes one
+	   snapshot at a time and in the order they were taken. */
+
+	g_mutex_lock(&cache->lock);
+
+	cache->save_id = 0;
+	entries = g_ptr_array_new_with_free_func(prv_entry_delete);
+
+	for (link = cache->lru.head; link; link = link->next)
+		g_ptr_array_add(entries, prv_entry_copy(link->data));
+
+	g_mutex_unlock(&cache->lock);
+
+	g_thread_pool_push(cache->save_pool, entries, NULL);
+}
+
+static gboolean prv_save_cb(gpointer user_data)
+{
+	prv_save(user_data);
+
+	return FALSE;
+}
+
+/* Saves are only scheduled when entries are added, evicted or found
+   stale.  Lookups reorder the queue without dirtying the cache; the
+   new order is written out with the next change. */
+
+static void prv_schedule_save(dlr_profile_cache_t *cache)
+{
+	if (!cache->save_id)
+		cache->save_id = g_timeout_add_seconds(
+						DLR_PROFILE_CACHE_SAVE_DELAY,
+						prv_save_cb, cache);
+}
+
+dlr_profile_cache_t *dlr_profile_cache_new(const gchar *cache_file,
+					   guint max_entries)
+{
+	dlr_profile_cache_t *cache;
+
+	cache = g_new0(dlr_profile_cache_t, 1);
+	cache->cache_file = g_strdup(cache_file);
+	cache->max_entries = max_entries;
+	cache->entries = g_hash_table_new_full(g_str_hash, g_str_equal,
+					       NULL, prv_entry_delete);
+	g_queue_init(&cache->lru);
+	g_mutex_init(&cache->lock);
+	cache->save_pool = g_thread_pool_new(prv_save_run, cache, 1, FALSE,
+					     NULL);
+
+	prv_load(cache);
+
+	return cache;
+}
+
+void dlr_profile_cache_delete(dlr_profile_cache_t *cache)
+{
+	if (cache) {
+		if (cache->save_id) {
+			(void) g_source_remove(cache->save_id);
+			prv_save(cache);
+		}
+
+		/* Waits for the pending snapshots to be written */
+
+		g_thread_pool_free(cache->save_pool, FALSE, TRUE);
+
+		g_queue_clear(&cache->lru);
+		g_hash_table_unref(cache->entries);
+		g_free(cache->cache_file);
+		g_mutex_clear(&cache->lock);
+		g_free(cache);
+	}
+}
+
+gboolean dlr_profile_cache_stamp(const gchar *file,
+				 dlr_profile_cache_stamp_t *stamp)
+{
+	GStatBuf buf;
+
+	if (g_stat(file, &buf) != 0)
+		return FALSE;
+
+	stamp->inode = buf.st_ino;
+	stamp->size = buf.st_size;
+	stamp->mtime = buf.st_mtime;
+
+	return TRUE;
+}
+
+gboolean dlr_profile_cache_lookup(dlr_profile_cache_t *cache,
+				  const gchar *file,
+				  const dlr_profile_cache_stamp_t *stamp,
+				  gchar **mime_type, gchar **dlna_header,
+				  gchar **seek_index)
+{
+	dlr_profile_entry_t *entry;
+	gboolean retval = FALSE;
+
+	/* Lookups are made from the threads probing the files, which
+	   have already stamped them. */
+
+	g_mutex_lock(&cache->lock);
+
+	entry = g_hash_table_lookup(cache->entries, file);
+
+	if (!entry)
+		goto on_exit;
+
+	if (stamp->inode != entry->stamp.inode ||
+	    stamp->size != entry->stamp.size ||
+	    stamp->mtime != entry->stamp.mtime) {
+		DLEYNA_LOG_DEBUG("Discarding stale profile for %s", file);
+
+		prv_remove_entry(cache, entry);
+		prv_schedule_save(cache);
+
+		goto on_exit;
+	}
+
+	g_queue_unlink(&cache->lru, entry->link);
+	g_queue_push_tail_link(&cache->lru, entry->link);
+
+	*mime_type = g_strdup(entry->mime_type);
+	*dlna_header = g_strdup(entry->dlna_header);
+	*seek_index = *entry->seek_index ? g_strdup(entry->seek_index) : NULL;
+
+	retval = TRUE;
+
+on_exit:
+
+	g_mutex_unlock(&cache->lock);
+
+	return retval;
+}
+
+void dlr_profile_cache_insert(dlr_profile_cache_t *cache, const gchar *file,
+			      const dlr_profile_cache_stamp_t *stamp,
+			      const gchar *mime_type,
+			      const gchar *dlna_header,
+			      const gchar *seek_index)
+{
+	dlr_profile_entry_t *entry;
+
+	entry = g_new0(dlr_profile_entry_t, 1);
+	entry->path = g_strdup(file);
+	entry->stamp = *stamp;
+	entry->mime_type = g_strdup(mime_type);
+	entry->dlna_header = g_strdup(dlna_header ? dlna_header : "");
+	entry->seek_index = g_strdup(seek_index ? seek_index : "");
+
+	g_mutex_lock(&cache->lock);
+	prv_add_entry(cache, entry);
+	prv_schedule_save(cache);
+	g_mutex_unlock(&cache->lock);
+}
@@ -0,0 +1,55 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef DLR_PROFILE_CACHE_H__
+#define DLR_PROFILE_CACHE_H__
+
+#include <glib.h>
+
+typedef struct dlr_profile_cache_t_ dlr_profile_cache_t;
+
+typedef struct dlr_profile_cache_stamp_t_ dlr_profile_cache_stamp_t;
+struct dlr_profile_cache_stamp_t_ {
+	guint64 inode;
+	gint64 size;
+	gint64 mtime;
+};
+
+dlr_profile_cache_t *dlr_profile_cache_new(const gchar *cache_file,
+					   guint max_entries);
+
+void dlr_profile_cache_delete(dlr_profile_cache_t *cache);
+
+gboolean dlr_profile_cache_stamp(const gchar *file,
+				 dlr_profile_cache_stamp_t *stamp);
+
+gboolean dlr_profile_cache_lookup(dlr_profile_cache_t *cache,
+				  const gchar *file,
+				  const dlr_profile_cache_stamp_t *stamp,
+				  gchar **mime_type, gchar **dlna_header,
+				  gchar **seek_index);
+
+void dlr_profile_cache_insert(dlr_profile_cache_t *cache, const gchar *file,
+			      const dlr_profile_cache_stamp_t *stamp,
+			      const gchar *mime_type,
+			      const gchar *dlna_header,
+			      const gchar *seek_index);
+
+#endif /* DLR_PROFILE_CACHE_H__ */
@@ -76,4 +76,68 @@
 #define DLR_INTERFACE_PROP_PRESENTATION_URL "PresentationURL"
 #define DLR_INTERFACE_PROP_PROTOCOL_INFO "ProtocolInfo"
 
+#define DLR_INTERFACE_PROP_REQUESTS "Requests"
+#define DLR_INTERFACE_PROP_BYTES_SENT "BytesSent"
+#define DLR_INTERFACE_PROP_ACTIVE_TRANSFERS "ActiveTransfers"
+#define DLR_INTERFACE_PROP_COMPLETED_TRANSFERS "CompletedTransfers"
+#define DLR_INTERFACE_PROP_ABORTED_TRANSFERS "AbortedTransfers"
+#define DLR_INTERFACE_PROP_THROUGHPUT "Throughput"
+
+/* Properties kept by each renderer, per interface.  Each entry is
+   X(id, name) and the lists are expanded by prop-store.h into the
+   property ids and name tables. */
+
+#define DLR_ROOT_PROPS(X) \
+	X(DLR_ROOT_PROP_CAN_QUIT, DLR_INTERFACE_PROP_CAN_QUIT) \
+	X(DLR_ROOT_PROP_CAN_RAISE, DLR_INTERFACE_PROP_CAN_RAISE) \
+	X(DLR_ROOT_PROP_CAN_SET_FULLSCREEN, \
+	  DLR_INTERFACE_PROP_CAN_SET_FULLSCREEN) \
+	X(DLR_ROOT_PROP_HAS_TRACK_LIST, DLR_INTERFACE_PROP_HAS_TRACK_LIST) \
+	X(DLR_ROOT_PROP_IDENTITY, DLR_INTERFACE_PROP_IDENTITY) \
+	X(DLR_ROOT_PROP_SUPPORTED_URIS, DLR_INTERFACE_PROP_SUPPORTED_URIS) \
+	X(DLR_ROOT_PROP_SUPPORTED_MIME, DLR_INTERFACE_PROP_SUPPORTED_MIME)
+
+#define DLR_PLAYER_PROPS(X) \
+	X(DLR_PLAYER_PROP_PLAYBACK_STATUS, \
+	  DLR_INTERFACE_PROP_PLAYBACK_STATUS) \
+	X(DLR_PLAYER_PROP_RATE, DLR_INTERFACE_PROP_RATE) \
+	X(DLR_PLAYER_PROP_CAN_PLAY, DLR_INTERFACE_PROP_CAN_PLAY) \
+	X(DLR_PLAYER_PROP_CAN_SEEK, DLR_INTERFACE_PROP_CAN_SEEK) \
+	X(DLR_PLAYER_PROP_CAN_BYTE_SEEK, DLR_INTERFACE_PROP_CAN_BYTE_SEEK) \
+	X(DLR_PLAYER_PROP_CAN_CONTROL, DLR_INTERFACE_PROP_CAN_CONTROL) \
+	X(DLR_PLAYER_PROP_CAN_PAUSE, DLR_INTERFACE_PROP_CAN_PAUSE) \
+	X(DLR_PLAYER_PROP_CAN_NEXT, DLR_INTERFACE_PROP_CAN_NEXT) \
+	X(DLR_PLAYER_PROP_CAN_PREVIOUS, DLR_INTERFACE_PROP_CAN_PREVIOUS) \
+	X(DLR_PLAYER_PROP_POSITION, DLR_INTERFACE_PROP_POSITION) \
+	X(DLR_PLAYER_PROP_BYTE_POSITION, DLR_INTERFACE_PROP_BYTE_POSITION) \
+	X(DLR_PLAYER_PROP_METADATA, DLR_INTERFACE_PROP_METADATA) \
+	X(DLR_PLAYER_PROP_TRANSPORT_PLAY_SPEEDS, \
+	  DLR_INTERFACE_PROP_TRANSPORT_PLAY_SPEEDS) \
+	X(DLR_PLAYER_PROP_MINIMUM_RATE, DLR_INTERFACE_PROP_MINIMUM_RATE) \
+	X(DLR_PLAYER_PROP_MAXIMUM_RATE, DLR_INTERFACE_PROP_MAXIMUM_RATE) \
+	X(DLR_PLAYER_PROP_VOLUME, DLR_INTERFACE_PROP_VOLUME) \
+	X(DLR_PLAYER_PROP_CURRENT_TRACK, DLR_INTERFACE_PROP_CURRENT_TRACK) \
+	X(DLR_PLAYER_PROP_NUMBER_OF_TRACKS, \
+	  DLR_INTERFACE_PROP_NUMBER_OF_TRACKS) \
+	X(DLR_PLAYER_PROP_MUTE, DLR_INTERFACE_PROP_MUTE)
+
+#define DLR_DEVICE_PROPS(X) \
+	X(DLR_DEVICE_PROP_DLNA_DEVICE_CLASSES, \
+	  DLR_INTERFACE_PROP_DLNA_DEVICE_CLASSES) \
+	X(DLR_DEVICE_PROP_DEVICE_TYPE, DLR_INTERFACE_PROP_DEVICE_TYPE) \
+	X(DLR_DEVICE_PROP_UDN, DLR_INTERFACE_PROP_UDN) \
+	X(DLR_DEVICE_PROP_FRIENDLY_NAME, DLR_INTERFACE_PROP_FRIENDLY_NAME) \
+	X(DLR_DEVICE_PROP_ICON_URL, DLR_INTERFACE_PROP_ICON_URL) \
+	X(DLR_DEVICE_PROP_MANUFACTURER, DLR_INTERFACE_PROP_MANUFACTURER) \
+	X(DLR_DEVICE_PROP_MANUFACTURER_URL, \
+	  DLR_INTERFACE_PROP_MANUFACTURER_URL) \
+	X(DLR_DEVICE_PROP_MODEL_DESCRIPTION, \
+	  DLR_INTERFACE_PROP_MODEL_DESCRIPTION) \
+	X(DLR_DEVICE_PROP_MODEL_NAME, DLR_INTERFACE_PROP_MODEL_NAME) \
+	X(DLR_DEVICE_PROP_MODEL_NUMBER, DLR_INTERFACE_PROP_MODEL_NUMBER) \
+	X(DLR_DEVICE_PROP_SERIAL_NUMBER, DLR_INTERFACE_PROP_SERIAL_NUMBER) \
+	X(DLR_DEVICE_PROP_PRESENTATION_URL, \
+	  DLR_INTERFACE_PROP_PRESENTATION_URL) \
+	X(DLR_DEVICE_PROP_PROTOCOL_INFO, DLR_INTERFACE_PROP_PROTOCOL_INFO)
+
 #endif /* DLR_PROPS_DEFS_H__ */
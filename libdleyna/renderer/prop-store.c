@@ -0,0 +1,155 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#include <glib.h>
+
+#include "prop-store.h"
+
+/* Properties are stored in an array indexed by the ids from prop-defs.h
+   rather than in a hash table keyed by name.  Names are only needed for
+   D-Bus Get requests, which are matched on quarks. */
+
+#define DLR_PROP_NAME(id, name) name,
+
+struct dlr_prop_table_t_ {
+	const gchar *const *names;
+	GQuark *quarks;
+	guint count;
+};
+
+struct dlr_prop_store_t_ {
+	dlr_prop_table_t *table;
+	GVariant *values[];
+};
+
+static const gchar *const g_root_names[] = {
+	DLR_ROOT_PROPS(DLR_PROP_NAME)
+};
+
+static const gchar *const g_player_names[] = {
+	DLR_PLAYER_PROPS(DLR_PROP_NAME)
+};
+
+static const gchar *const g_device_names[] = {
+	DLR_DEVICE_PROPS(DLR_PROP_NAME)
+};
+
+static GQuark g_root_quarks[DLR_ROOT_PROP_MAX];
+static GQuark g_player_quarks[DLR_PLAYER_PROP_MAX];
+static GQuark g_device_quarks[DLR_DEVICE_PROP_MAX];
+
+dlr_prop_table_t dlr_prop_root_table = {
+	g_root_names, g_root_quarks, DLR_ROOT_PROP_MAX
+};
+
+dlr_prop_table_t dlr_prop_player_table = {
+	g_player_names, g_player_quarks, DLR_PLAYER_PROP_MAX
+};
+
+dlr_prop_table_t dlr_prop_device_table = {
+	g_device_names, g_device_quarks, DLR_DEVICE_PROP_MAX
+};
+
+dlr_prop_store_t *dlr_prop_store_new(dlr_prop_table_t *table)
+{
+	dlr_prop_store_t *store;
+	guint i;
+
+	if (!table->quarks[0])
+		for (i = 0; i < table->count; ++i)
+			table->quarks[i] =
+				g_quark_from_static_string(table->names[i]);
+
+	store = g_malloc0(sizeof(*store) + table->count * sizeof(GVariant *));
+	store->table = table;
+
+	return store;
+}
+
+void dlr_prop_store_delete(dlr_prop_store_t *store)
+{
+	guint i;
+
+	if (store) {
+		for (i = 0; i < store->table->count; ++i)
+			if (store->values[i])
+				g_variant_unref(store->values[i]);
+
+		g_free(store);
+	}
+}
+
+const gchar *dlr_prop_store_get_name(dlr_prop_store_t *store, guint id)
+{
+	return store->table->names[id];
+}
+
+GVariant *dlr_prop_store_get(dlr_prop_store_t *store, guint id)
+{
+	return store->values[id];
+}
+
+GVariant *dlr_prop_store_lookup(dlr_prop_store_t *store, const gchar *name)
+{
+	GQuark quark = g_quark_try_string(name);
+	GVariant *value = NULL;
+	guint i;
+
+	/* A name that was never interned cannot be a property */
+
+	if (!quark)
+		goto on_exit;
+
+	for (i = 0; i < store->table->count; ++i) {
+		if (store->table->quarks[i] == quark) {
+			value = store->values[i];
+			break;
+		}
+	}
+
+on_exit:
+
+	return value;
+}
+
+void dlr_prop_store_set(dlr_prop_store_t *store, guint id, GVariant *value)
+{
+	if (store->values[id])
+		g_variant_unref(store->values[id]);
+
+	store->values[id] = value;
+}
+
+void dlr_prop_store_remove(dlr_prop_store_t *store, guint id)
+{
+	dlr_prop_store_set(store, id, NULL);
+}
+
+void dlr_prop_store_add_all(dlr_prop_store_t *store, GVariantBuilder *vb)
+{
+	guint i;
+
+	for (i = 0; i < store->table->count; ++i)
+		if (store->values[i])
+			g_variant_builder_add(vb, "{sv}",
+					      store->table->names[i],
+					      store->values[i]);
+}
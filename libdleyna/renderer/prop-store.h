@@ -0,0 +1,68 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef DLR_PROP_STORE_H__
+#define DLR_PROP_STORE_H__
+
+#include <glib.h>
+
+#include "prop-defs.h"
+
+#define DLR_PROP_ID(id, name) id,
+
+typedef enum {
+	DLR_ROOT_PROPS(DLR_PROP_ID)
+	DLR_ROOT_PROP_MAX
+} dlr_root_prop_t;
+
+typedef enum {
+	DLR_PLAYER_PROPS(DLR_PROP_ID)
+	DLR_PLAYER_PROP_MAX
+} dlr_player_prop_t;
+
+typedef enum {
+	DLR_DEVICE_PROPS(DLR_PROP_ID)
+	DLR_DEVICE_PROP_MAX
+} dlr_device_prop_t;
+
+typedef struct dlr_prop_table_t_ dlr_prop_table_t;
+typedef struct dlr_prop_store_t_ dlr_prop_store_t;
+
+extern dlr_prop_table_t dlr_prop_root_table;
+extern dlr_prop_table_t dlr_prop_player_table;
+extern dlr_prop_table_t dlr_prop_device_table;
+
+dlr_prop_store_t *dlr_prop_store_new(dlr_prop_table_t *table);
+
+void dlr_prop_store_delete(dlr_prop_store_t *store);
+
+const gchar *dlr_prop_store_get_name(dlr_prop_store_t *store, guint id);
+
+GVariant *dlr_prop_store_get(dlr_prop_store_t *store, guint id);
+
+GVariant *dlr_prop_store_lookup(dlr_prop_store_t *store, const gchar *name);
+
+void dlr_prop_store_set(dlr_prop_store_t *store, guint id, GVariant *value);
+
+void dlr_prop_store_remove(dlr_prop_store_t *store, guint id);
+
+void dlr_prop_store_add_all(dlr_prop_store_t *store, GVariantBuilder *vb);
+
+#endif /* DLR_PROP_STORE_H__ */
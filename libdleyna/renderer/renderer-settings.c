@@ -0,0 +1,277 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <glib.h>
+
+#include <libdleyna/core/log.h>
+
+#include "renderer-settings.h"
+
+#define DLR_SETTINGS_FILE_NAME "dleyna-renderer-service.conf"
+
+#define DLR_SETTINGS_GROUP_GENERAL "general"
+#define DLR_SETTINGS_KEY_PROPERTIES_CHANGED_DELAY "properties-changed-delay"
+
+#define DLR_SETTINGS_GROUP_PUSH_HOST "push-host"
+#define DLR_SETTINGS_KEY_MAP_CACHE_SIZE "map-cache-size"
+#define DLR_SETTINGS_KEY_STREAM_THRESHOLD "stream-threshold"
+#define DLR_SETTINGS_KEY_LIVE_TIMEOUT "live-timeout"
+#define DLR_SETTINGS_KEY_MAX_RATE "max-rate"
+#define DLR_SETTINGS_KEY_CLIENT_MAX_RATE "client-max-rate"
+#define DLR_SETTINGS_KEY_CONNECTION_MAX_RATE "connection-max-rate"
+#define DLR_SETTINGS_KEY_LOCAL_FILE_URIS "local-file-uris"
+#define DLR_SETTINGS_KEY_SCALE_IMAGES "scale-images"
+#define DLR_SETTINGS_KEY_ACCESS_LOG "access-log"
+#define DLR_SETTINGS_KEY_ACCESS_LOG_MAX_SIZE "access-log-max-size"
+#define DLR_SETTINGS_KEY_ACCESS_LOG_FILES "access-log-files"
+
+#define DLR_SETTINGS_DEFAULT_PROPERTIES_CHANGED_DELAY 20
+#define DLR_SETTINGS_DEFAULT_MAP_CACHE_SIZE 64
+#define DLR_SETTINGS_DEFAULT_STREAM_THRESHOLD 512
+#define DLR_SETTINGS_DEFAULT_LIVE_TIMEOUT 10
+#define DLR_SETTINGS_DEFAULT_ACCESS_LOG_MAX_SIZE 16
+#define DLR_SETTINGS_DEFAULT_ACCESS_LOG_FILES 4
+
+static gchar *prv_get_file_path(void)
+{
+	gchar *path;
+
+	path = g_build_filename(g_get_user_config_dir(),
+				DLR_SETTINGS_FILE_NAME, NULL);
+
+	if (!g_file_test(path, G_FILE_TEST_EXISTS)) {
+		g_free(path);
+		path = g_build_filename(SYS_CONFIG_DIR,
+					DLR_SETTINGS_FILE_NAME, NULL);
+	}
+
+	return path;
+}
+
+static void prv_get_uint(GKeyFile *keyfile, const gchar *group,
+			 const gchar *key, guint *value)
+{
+	GError *error = NULL;
+	gint int_value;
+
+	if (!g_key_file_has_key(keyfile, group, key, NULL))
+		goto on_exit;
+
+	int_value = g_key_file_get_integer(keyfile, group, key, &error);
+
+	if (error || int_value < 0) {
+		DLEYNA_LOG_WARNING("Invalid value for %s/%s, using %u",
+				   group, key, *value);
+
+		if (error)
+			g_error_free(error);
+
+		goto on_exit;
+	}
+
+	*value = int_value;
+
+on_exit:
+
+	return;
+}
+
+static void prv_get_boolean(GKeyFile *keyfile, const gchar *group,
+			    const gchar *key, gboolean *value)
+{
+	GError *error = NULL;
+	gboolean bool_value;
+
+	if (!g_key_file_has_key(keyfile, group, key, NULL))
+		goto on_exit;
+
+	bool_value = g_key_file_get_boolean(keyfile, group, key, &error);
+
+	if (error) {
+		DLEYNA_LOG_WARNING("Invalid value for %s/%s, using %s",
+				   group, key, *value ? "true" : "false");
+		g_error_free(error);
+
+		goto on_exit;
+	}
+
+	*value = bool_value;
+
+on_exit:
+
+	return;
+}
+
+static void prv_get_path(GKeyFile *keyfile, const gchar *group,
+			 const gchar *key, gchar **value)
+{
+	gchar *str;
+
+	str = g_key_file_get_string(keyfile, group, key, NULL);
+
+	if (!str)
+		goto on_exit;
+
+	g_strstrip(str);
+
+	/* An empty value leaves the option disabled.  Relative paths are
+	   taken from the user cache directory. */
+
+	if (!*str) {
+		g_free(str);
+		goto on_exit;
+	}
+
+	if (g_path_is_absolute(str)) {
+		*value = str;
+	} else {
+		*value = g_build_filename(g_get_user_cache_dir(),
+					  "dleyna-renderer", str, NULL);
+		g_free(str);
+	}
+
+on_exit:
+
+	return;
+}
+
+void dlr_renderer_settings_load(dlr_renderer_settings_t *settings)
+{
+	GKeyFile *keyfile;
+	gchar *path;
+
+	settings->properties_changed_delay =
+				DLR_SETTINGS_DEFAULT_PROPERTIES_CHANGED_DELAY;
+	settings->push_host_map_cache_size =
+					DLR_SETTINGS_DEFAULT_MAP_CACHE_SIZE;
+	settings->push_host_stream_threshold =
+					DLR_SETTINGS_DEFAULT_STREAM_THRESHOLD;
+	settings->push_host_live_timeout = DLR_SETTINGS_DEFAULT_LIVE_TIMEOUT;
+	settings->push_host_max_rate = 0;
+	settings->push_host_client_max_rate = 0;
+	settings->push_host_connection_max_rate = 0;
+	settings->push_host_local_file_uris = TRUE;
+	settings->push_host_scale_images = TRUE;
+	settings->push_host_access_log = NULL;
+	settings->push_host_access_log_max_size =
+				DLR_SETTINGS_DEFAULT_ACCESS_LOG_MAX_SIZE;
+	settings->push_host_access_log_files =
+				DLR_SETTINGS_DEFAULT_ACCESS_LOG_FILES;
+
+	keyfile = g_key_file_new();
+	path = prv_get_file_path();
+
+	if (!g_key_file_load_from_file(keyfile, path, G_KEY_FILE_NONE, NULL)) {
+		DLEYNA_LOG_DEBUG("Unable to load %s, using defaults", path);
+
+		goto on_exit;
+	}
+
+	prv_get_uint(keyfile, DLR_SETTINGS_GROUP_GENERAL,
+		     DLR_SETTINGS_KEY_PROPERTIES_CHANGED_DELAY,
+		     &settings->properties_changed_delay);
+
+	prv_get_uint(keyfile, DLR_SETTINGS_GROUP_PUSH_HOST,
+		     DLR_SETTINGS_KEY_MAP_CACHE_SIZE,
+		     &settings->push_host_map_cache_size);
+
+	prv_get_uint(keyfile, DLR_SETTINGS_GROUP_PUSH_HOST,
+		     DLR_SETTINGS_KEY_STREAM_THRESHOLD,
+		     &settings->push_host_stream_threshold);
+
+	prv_get_uint(keyfile, DLR_SETTINGS_GROUP_PUSH_HOST,
+		     DLR_SETTINGS_KEY_LIVE_TIMEOUT,
+		     &settings->push_host_live_timeout);
+
+	prv_get_uint(keyfile, DLR_SETTINGS_GROUP_PUSH_HOST,
+		     DLR_SETTINGS_KEY_MAX_RATE,
+		     &settings->push_host_max_rate);
+
+	prv_get_uint(keyfile, DLR_SETTINGS_GROUP_PUSH_HOST,
+		     DLR_SETTINGS_KEY_CLIENT_MAX_RATE,
+		     &settings->push_host_client_max_rate);
+
+	prv_get_uint(keyfile, DLR_SETTINGS_GROUP_PUSH_HOST,
+		     DLR_SETTINGS_KEY_CONNECTION_MAX_RATE,
+		     &settings->push_host_connection_max_rate);
+
+	prv_get_boolean(keyfile, DLR_SETTINGS_GROUP_PUSH_HOST,
+			DLR_SETTINGS_KEY_LOCAL_FILE_URIS,
+			&settings->push_host_local_file_uris);
+
+	prv_get_boolean(keyfile, DLR_SETTINGS_GROUP_PUSH_HOST,
+			DLR_SETTINGS_KEY_SCALE_IMAGES,
+			&settings->push_host_scale_images);
+
+	prv_get_path(keyfile, DLR_SETTINGS_GROUP_PUSH_HOST,
+		     DLR_SETTINGS_KEY_ACCESS_LOG,
+		     &settings->push_host_access_log);
+
+	prv_get_uint(keyfile, DLR_SETTINGS_GROUP_PUSH_HOST,
+		     DLR_SETTINGS_KEY_ACCESS_LOG_MAX_SIZE,
+		     &settings->push_host_access_log_max_size);
+
+	prv_get_uint(keyfile, DLR_SETTINGS_GROUP_PUSH_HOST,
+		     DLR_SETTINGS_KEY_ACCESS_LOG_FILES,
+		     &settings->push_host_access_log_files);
+
+	DLEYNA_LOG_DEBUG("[%s] %s = %u ms", DLR_SETTINGS_GROUP_GENERAL,
+			 DLR_SETTINGS_KEY_PROPERTIES_CHANGED_DELAY,
+			 settings->properties_changed_delay);
+	DLEYNA_LOG_DEBUG("[%s] %s = %u MiB", DLR_SETTINGS_GROUP_PUSH_HOST,
+			 DLR_SETTINGS_KEY_MAP_CACHE_SIZE,
+			 settings->push_host_map_cache_size);
+	DLEYNA_LOG_DEBUG("[%s] %s = %u MiB", DLR_SETTINGS_GROUP_PUSH_HOST,
+			 DLR_SETTINGS_KEY_STREAM_THRESHOLD,
+			 settings->push_host_stream_threshold);
+	DLEYNA_LOG_DEBUG("[%s] %s = %u s", DLR_SETTINGS_GROUP_PUSH_HOST,
+			 DLR_SETTINGS_KEY_LIVE_TIMEOUT,
+			 settings->push_host_live_timeout);
+	DLEYNA_LOG_DEBUG("[%s] %s = %u KiB/s", DLR_SETTINGS_GROUP_PUSH_HOST,
+			 DLR_SETTINGS_KEY_MAX_RATE,
+			 settings->push_host_max_rate);
+	DLEYNA_LOG_DEBUG("[%s] %s = %u KiB/s", DLR_SETTINGS_GROUP_PUSH_HOST,
+			 DLR_SETTINGS_KEY_CLIENT_MAX_RATE,
+			 settings->push_host_client_max_rate);
+	DLEYNA_LOG_DEBUG("[%s] %s = %u KiB/s", DLR_SETTINGS_GROUP_PUSH_HOST,
+			 DLR_SETTINGS_KEY_CONNECTION_MAX_RATE,
+			 settings->push_host_connection_max_rate);
+	DLEYNA_LOG_DEBUG("[%s] %s = %s", DLR_SETTINGS_GROUP_PUSH_HOST,
+			 DLR_SETTINGS_KEY_LOCAL_FILE_URIS,
+			 settings->push_host_local_file_uris ? "true" : "false");
+	DLEYNA_LOG_DEBUG("[%s] %s = %s", DLR_SETTINGS_GROUP_PUSH_HOST,
+			 DLR_SETTINGS_KEY_SCALE_IMAGES,
+			 settings->push_host_scale_images ? "true" : "false");
+	DLEYNA_LOG_DEBUG("[%s] %s = %s", DLR_SETTINGS_GROUP_PUSH_HOST,
+			 DLR_SETTINGS_KEY_ACCESS_LOG,
+			 settings->push_host_access_log ?
+			 settings->push_host_access_log : "(disabled)");
+
+on_exit:
+
+	g_free(path);
+	g_key_file_free(keyfile);
+}
+
+void dlr_renderer_settings_clear(dlr_renderer_settings_t *settings)
+{
+	g_free(settings->push_host_access_log);
+	settings->push_host_access_log = NULL;
+}
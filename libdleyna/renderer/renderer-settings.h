@@ -0,0 +1,49 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef DLR_RENDERER_SETTINGS_H__
+#define DLR_RENDERER_SETTINGS_H__
+
+#include <glib.h>
+
+/* Settings specific to dleyna-renderer.  They are read from the same
+   configuration file as the settings managed by dleyna-core. */
+
+typedef struct dlr_renderer_settings_t_ dlr_renderer_settings_t;
+struct dlr_renderer_settings_t_ {
+	guint properties_changed_delay;
+	guint push_host_map_cache_size;
+	guint push_host_stream_threshold;
+	guint push_host_live_timeout;
+	guint push_host_max_rate;
+	guint push_host_client_max_rate;
+	guint push_host_connection_max_rate;
+	gboolean push_host_local_file_uris;
+	gboolean push_host_scale_images;
+	gchar *push_host_access_log;
+	guint push_host_access_log_max_size;
+	guint push_host_access_log_files;
+};
+
+void dlr_renderer_settings_load(dlr_renderer_settings_t *settings);
+
+void dlr_renderer_settings_clear(dlr_renderer_settings_t *settings);
+
+#endif /* DLR_RENDERER_SETTINGS_H__ */
@@ -0,0 +1,799 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libdleyna/core/log.h>
+
+#include "seek-index.h"
+
+#define DLR_SEEK_INDEX_MAX_ENTRIES 512
+
+#define DLR_SEEK_INDEX_TS_SAMPLES 128
+#define DLR_SEEK_INDEX_TS_BLOCK_PACKETS 348
+#define DLR_SEEK_INDEX_TS_SCAN (1024 * 1024)
+#define DLR_SEEK_INDEX_TS_PCR_WRAP (G_GINT64_CONSTANT(1) << 33)
+
+#define DLR_SEEK_INDEX_MP4_MAX_MOOV (64 * 1024 * 1024)
+
+#define DLR_SEEK_INDEX_FOURCC(a, b, c, d) \
+	(((guint32)(a) << 24) | ((guint32)(b) << 16) | \
+	 ((guint32)(c) << 8) | (guint32)(d))
+
+typedef struct dlr_seek_entry_t_ dlr_seek_entry_t;
+struct dlr_seek_entry_t_ {
+	gint64 time;
+	goffset offset;
+};
+
+/* Times are in milliseconds from the start of the file.  The index
+   is never modified once built, so it can be shared between threads. */
+
+struct dlr_seek_index_t_ {
+	gint ref_count;
+	gint64 duration;
+	GArray *entries;
+};
+
+typedef struct dlr_mp4_table_t_ dlr_mp4_table_t;
+struct dlr_mp4_table_t_ {
+	const guchar *data;
+	guint32 count;
+};
+
+static dlr_seek_index_t *prv_seek_index_new(void)
+{
+	dlr_seek_index_t *index;
+
+	index = g_new0(dlr_seek_index_t, 1);
+	index->ref_count = 1;
+	index->entries = g_array_new(FALSE, FALSE, sizeof(dlr_seek_entry_t));
+
+	return index;
+}
+
+static void prv_seek_index_add(dlr_seek_index_t *index, gint64 time,
+			       goffset offset)
+{
+	dlr_seek_entry_t entry;
+	dlr_seek_entry_t *last;
+
+	/* Entries must increase in both time and offset.  Anything else,
+	   such as a timestamp discontinuity, is simply left out. */
+
+	if (index->entries->len > 0) {
+		last = &g_array_index(index->entries, dlr_seek_entry_t,
+				      index->entries->len - 1);
+
+		if (time <= last->time || offset <= last->offset)
+			return;
+	}
+
+	entry.time = time;
+	entry.offset = offset;
+	g_array_append_val(index->entries, entry);
+}
+
+static dlr_seek_index_t *prv_seek_index_check(dlr_seek_index_t *index)
+{
+	/* An index with a single entry cannot help anybody seek */
+
+	if (index->entries->len < 2 || index->duration <= 0) {
+		dlr_seek_index_unref(index);
+		index = NULL;
+	}
+
+	return index;
+}
+
+static guint32 prv_read_u32(const guchar *data)
+{
+	return ((guint32)data[0] << 24) | ((guint32)data[1] << 16) |
+		((guint32)data[2] << 8) | (guint32)data[3];
+}
+
+static guint64 prv_read_u64(const guchar *data)
+{
+	return ((guint64)prv_read_u32(data) << 32) | prv_read_u32(data + 4);
+}
+
+static guint prv_ts_packet_size(const guchar *data, gsize length)
+{
+	static const guint sizes[] = { 188, 192 };
+	guint size;
+	guint skip;
+	unsigned int i;
+
+	/* M2TS packets carry a four byte timestamp before the sync byte */
+
+	for (i = 0; i < G_N_ELEMENTS(sizes); ++i) {
+		size = sizes[i];
+		skip = size - 188;
+
+		if (skip + 2 * size < length && data[skip] == 0x47 &&
+		    data[skip + size] == 0x47 && data[skip + 2 * size] == 0x47)
+			return size;
+	}
+
+	return 0;
+}
+
+static gboolean prv_ts_packet_pcr(const guchar *packet, gint *pid,
+				  gint64 *pcr)
+{
+	gint packet_pid = ((packet[1] & 0x1f) << 8) | packet[2];
+
+	if ((*pid >= 0) && (packet_pid != *pid))
+		return FALSE;
+
+	/* An adaptation field of at least 7 bytes with the PCR flag set */
+
+	if (!(packet[3] & 0x20) || (packet[4] < 7) || !(packet[5] & 0x10))
+		return FALSE;
+
+	*pcr = ((gint64)packet[6] << 25) | ((gint64)packet[7] << 17) |
+		((gint64)packet[8] << 9) | ((gint64)packet[9] << 1) |
+		(packet[10] >> 7);
+	*pid = packet_pid;
+
+	return TRUE;
+}
+
+static gboolean prv_ts_find_pcr(int fd, goffset from, goffset to,
+				guint packet_size, gboolean last, gint *pid,
+				gint64 *pcr, goffset *offset)
+{
+	gsize block_size = packet_size * DLR_SEEK_INDEX_TS_BLOCK_PACKETS;
+	guint skip = packet_size - 188;
+	guchar *buffer;
+	gssize length;
+	gsize i;
+	gboolean synced = FALSE;
+	gboolean found = FALSE;
+
+	/* Returns the first PCR found after from, or the last one before
+	   to.  Only the PCRs of the first PID seen carrying one are used,
+	   so that the clocks of different programs are never mixed. */
+
+	buffer = g_malloc(block_size);
+
+	while (from < to) {
+		length = pread(fd, buffer, MIN(block_size, to - from), from);
+		if (length < (gssize) (3 * packet_size))
+			break;
+
+		i = 0;
+
+		if (!synced) {
+			while (i + skip + packet_size < (gsize) length &&
+			       (buffer[i + skip] != 0x47 ||
+				buffer[i + skip + packet_size] != 0x47))
+				++i;
+
+			if (i + skip + packet_size >= (gsize) length) {
+				from += length - 2 * packet_size;
+				continue;
+			}
+
+			synced = TRUE;
+		}
+
+		for (; i + packet_size <= (gsize) length; i += packet_size) {
+			if (buffer[i + skip] != 0x47) {
+				synced = FALSE;
+				break;
+			}
+
+			if (prv_ts_packet_pcr(buffer + i + skip, pid, pcr)) {
+				*offset = from + i;
+				found = TRUE;
+
+				if (!last)
+					goto on_exit;
+			}
+		}
+
+		from += synced ? i : i + 1;
+	}
+
+on_exit:
+
+	g_free(buffer);
+
+	return found;
+}
+
+static gint64 prv_ts_pcr_to_ms(gint64 pcr, gint64 first_pcr)
+{
+	/* The 33 bit PCR base runs at 90 kHz and may have wrapped */
+
+	if (pcr < first_pcr)
+		pcr += DLR_SEEK_INDEX_TS_PCR_WRAP;
+
+	return (pcr - first_pcr) / 90;
+}
+
+static dlr_seek_index_t *prv_ts_index_new(int fd, goffset size,
+					  guint packet_size)
+{
+	dlr_seek_index_t *index = NULL;
+	gint pid = -1;
+	gint64 first_pcr;
+	gint64 pcr;
+	goffset offset;
+	goffset from;
+	unsigned int i;
+
+	/* Rather than reading the whole stream, the PCR is sampled at
+	   evenly spaced points, which is enough to seek to within a few
+	   seconds of the requested time in a constant bit rate stream. */
+
+	if (!prv_ts_find_pcr(fd, 0, MIN(size, DLR_SEEK_INDEX_TS_SCAN),
+			     packet_size, FALSE, &pid, &first_pcr, &offset))
+		goto on_exit;
+
+	index = prv_seek_index_new();
+	prv_seek_index_add(index, 0, 0);
+
+	for (i = 1; i < DLR_SEEK_INDEX_TS_SAMPLES; ++i) {
+		from = size / DLR_SEEK_INDEX_TS_SAMPLES * i;
+
+		if (prv_ts_find_pcr(fd, from,
+				    MIN(size, from + DLR_SEEK_INDEX_TS_SCAN),
+				    packet_size, FALSE, &pid, &pcr, &offset))
+			prv_seek_index_add(index,
+					   prv_ts_pcr_to_ms(pcr, first_pcr),
+					   offset);
+	}
+
+	from = MAX(0, size - DLR_SEEK_INDEX_TS_SCAN);
+	if (prv_ts_find_pcr(fd, from, size, packet_size, TRUE, &pid, &pcr,
+			    &offset))
+		index->duration = prv_ts_pcr_to_ms(pcr, first_pcr);
+
+	index = prv_seek_index_check(index);
+
+on_exit:
+
+	return index;
+}
+
+static gboolean prv_mp4_next_box(const guchar *data, gsize length,
+				 gsize *pos, guint32 *type,
+				 const guchar **body, gsize *body_length)
+{
+	guint64 size;
+	gsize header = 8;
+
+	if (*pos + 8 > length)
+		return FALSE;
+
+	size = prv_read_u32(data + *pos);
+	*type = prv_read_u32(data + *pos + 4);
+
+	if (size == 1) {
+		if (*pos + 16 > length)
+			return FALSE;
+
+		size = prv_read_u64(data + *pos + 8);
+		header = 16;
+	} else if (size == 0) {
+		size = length - *pos;
+	}
+
+	if ((size < header) || (size > length - *pos))
+		return FALSE;
+
+	*body = data + *pos + header;
+	*body_length = size - header;
+	*pos += size;
+
+	return TRUE;
+}
+
+static const guchar *prv_mp4_find_box(const guchar *data, gsize length,
+				      const gchar *type, gsize *body_length)
+{
+	gsize pos = 0;
+	guint32 box_type;
+	const guchar *body;
+
+	if (!data)
+		return NULL;
+
+	while (prv_mp4_next_box(data, length, &pos, &box_type, &body,
+				body_length))
+		if (box_type == prv_read_u32((const guchar *) type))
+			return body;
+
+	return NULL;
+}
+
+static gboolean prv_mp4_get_table(const guchar *stbl, gsize stbl_length,
+				  const gchar *type, gsize entry_size,
+				  dlr_mp4_table_t *table)
+{
+	const guchar *body;
+	gsize length;
+
+	/* Sample tables start with a version, flags and an entry count */
+
+	body = prv_mp4_find_box(stbl, stbl_length, type, &length);
+	if (!body || length < 8)
+		return FALSE;
+
+	table->count = prv_read_u32(body + 4);
+	table->data = body + 8;
+
+	return table->count <= (length - 8) / entry_size;
+}
+
+static guchar *prv_mp4_read_moov(int fd, goffset size, gsize *length)
+{
+	guchar header[16];
+	guint64 box_size;
+	gsize header_size;
+	guchar *moov = NULL;
+	goffset pos = 0;
+
+	/* Only the box headers are read until moov is found, so this is
+	   cheap wherever the movie box lives in the file. */
+
+	while (pos + 16 <= size) {
+		if (pread(fd, header, sizeof(header), pos) != sizeof(header))
+			break;
+
+		box_size = prv_read_u32(header);
+		header_size = 8;
+
+		if (box_size == 1) {
+			box_size = prv_read_u64(header + 8);
+			header_size = 16;
+		} else if (box_size == 0) {
+			box_size = size - pos;
+		}
+
+		if (box_size < header_size)
+			break;
+
+		if (prv_read_u32(header + 4) ==
+		    DLR_SEEK_INDEX_FOURCC('m', 'o', 'o', 'v')) {
+			*length = box_size - header_size;
+			if (*length > DLR_SEEK_INDEX_MP4_MAX_MOOV)
+				break;
+
+			moov = g_malloc(*length);
+			if (pread(fd, moov, *length, pos + header_size) !=
+			    (gssize) *length) {
+				g_free(moov);
+				moov = NULL;
+			}
+
+			break;
+		}
+
+		pos += box_size;
+	}
+
+	return moov;
+}
+
+static dlr_seek_index_t *prv_mp4_index_track(const guchar *stbl,
+					     gsize stbl_length,
+					     guint32 timescale,
+					     guint64 duration)
+{
+	dlr_seek_index_t *index = NULL;
+	dlr_mp4_table_t stts;
+	dlr_mp4_table_t stss;
+	dlr_mp4_table_t stsc;
+	dlr_mp4_table_t stsz;
+	dlr_mp4_table_t stco;
+	const guchar *body;
+	gsize length;
+	gboolean co64 = FALSE;
+	gboolean has_stss;
+	guint32 sample_size;
+	guint32 sample = 0;
+	guint32 chunk;
+	guint32 stsc_i = 0;
+	guint32 stts_i = 0;
+	guint32 stts_left = 0;
+	guint32 stss_i = 0;
+	guint32 per_chunk;
+	guint32 k;
+	guint64 dts = 0;
+	goffset offset;
+	gint64 time;
+	gint64 gap;
+
+	if (!prv_mp4_get_table(stbl, stbl_length, "stts", 8, &stts) ||
+	    !prv_mp4_get_table(stbl, stbl_length, "stsc", 12, &stsc))
+		goto on_exit;
+
+	/* stsz has a default sample size before its count, in which case
+	   there are no individual sizes. */
+
+	body = prv_mp4_find_box(stbl, stbl_length, "stsz", &length);
+	if (!body || length < 12)
+		goto on_exit;
+
+	sample_size = prv_read_u32(body + 4);
+	stsz.count = prv_read_u32(body + 8);
+	stsz.data = body + 12;
+
+	if (!sample_size && stsz.count > (length - 12) / 4)
+		goto on_exit;
+
+	if (!prv_mp4_get_table(stbl, stbl_length, "stco", 4, &stco)) {
+		if (!prv_mp4_get_table(stbl, stbl_length, "co64", 8,
+				       &stco))
+			goto on_exit;
+
+		co64 = TRUE;
+	}
+
+	/* Without a sync sample table every sample is a sync sample */
+
+	has_stss = prv_mp4_get_table(stbl, stbl_length, "stss", 4, &stss);
+
+	if (timescale == 0 || stsc.count == 0)
+		goto on_exit;
+
+	index = prv_seek_index_new();
+	index->duration = duration * 1000 / timescale;
+	gap = index->duration / DLR_SEEK_INDEX_MAX_ENTRIES;
+
+	/* Seeking to the very start sends the whole file, including the
+	   boxes that come before the first sample. */
+
+	prv_seek_index_add(index, 0, 0);
+
+	if (stts.count > 0)
+		stts_left = prv_read_u32(stts.data);
+
+	for (chunk = 0; chunk < stco.count && sample < stsz.count; ++chunk) {
+		while (stsc_i + 1 < stsc.count &&
+		       chunk + 1 >= prv_read_u32(stsc.data +
+						 (stsc_i + 1) * 12))
+			++stsc_i;
+
+		per_chunk = prv_read_u32(stsc.data + stsc_i * 12 + 4);
+		offset = co64 ? (goffset) prv_read_u64(stco.data + chunk * 8) :
+			(goffset) prv_read_u32(stco.data + chunk * 4);
+
+		for (k = 0; k < per_chunk && sample < stsz.count; ++k) {
+			if (!has_stss) {
+				time = dts * 1000 / timescale;
+			} else if (stss_i < stss.count &&
+				   prv_read_u32(stss.data + stss_i * 4) ==
+				   sample + 1) {
+				time = dts * 1000 / timescale;
+				++stss_i;
+			} else {
+				time = -1;
+			}
+
+			if (time > 0 && time >= gap *
+			    (gint64) index->entries->len)
+				prv_seek_index_add(index, time, offset);
+
+			offset += sample_size ? sample_size :
+				prv_read_u32(stsz.data + sample * 4);
+
+			while (stts_left == 0 && stts_i + 1 < stts.count)
+				stts_left = prv_read_u32(stts.data +
+							 ++stts_i * 8);
+
+			if (stts_left > 0) {
+				dts += prv_read_u32(stts.data + stts_i * 8 + 4);
+				--stts_left;
+			}
+
+			++sample;
+		}
+	}
+
+	if (index->duration <= 0)
+		index->duration = dts * 1000 / timescale;
+
+	index = prv_seek_index_check(index);
+
+on_exit:
+
+	return index;
+}
+
+static dlr_seek_index_t *prv_mp4_index_new(int fd, goffset size)
+{
+	dlr_seek_index_t *index = NULL;
+	guchar *moov;
+	gsize moov_length;
+	gsize pos = 0;
+	guint32 type;
+	const guchar *trak;
+	gsize trak_length;
+	const guchar *mdia;
+	gsize mdia_length;
+	const guchar *mdhd;
+	gsize mdhd_length;
+	const guchar *hdlr;
+	gsize hdlr_length;
+	const guchar *minf;
+	gsize minf_length;
+	const guchar *stbl;
+	gsize stbl_length;
+	const guchar *best_stbl = NULL;
+	gsize best_stbl_length = 0;
+	guint32 best_handler = 0;
+	guint32 handler;
+	guint32 timescale = 0;
+	guint64 duration = 0;
+
+	moov = prv_mp4_read_moov(fd, size, &moov_length);
+	if (!moov)
+		goto on_exit;
+
+	/* The video track is indexed if there is one, so that seeks land
+	   on key frames.  Otherwise the first audio track is used. */
+
+	while (prv_mp4_next_box(moov, moov_length, &pos, &type, &trak,
+				&trak_length)) {
+		if (type != DLR_SEEK_INDEX_FOURCC('t', 'r', 'a', 'k'))
+			continue;
+
+		mdia = prv_mp4_find_box(trak, trak_length, "mdia",
+					&mdia_length);
+		mdhd = prv_mp4_find_box(mdia, mdia_length, "mdhd",
+					&mdhd_length);
+		hdlr = prv_mp4_find_box(mdia, mdia_length, "hdlr",
+					&hdlr_length);
+		minf = prv_mp4_find_box(mdia, mdia_length, "minf",
+					&minf_length);
+		stbl = prv_mp4_find_box(minf, minf_length, "stbl",
+					&stbl_length);
+
+		if (!mdhd || !hdlr || !stbl || hdlr_length < 12 ||
+		    mdhd_length < (mdhd[0] == 1 ? 32 : 20))
+			continue;
+
+		handler = prv_read_u32(hdlr + 8);
+
+		if ((handler != DLR_SEEK_INDEX_FOURCC('v', 'i', 'd', 'e') &&
+		     handler != DLR_SEEK_INDEX_FOURCC('s', 'o', 'u', 'n')) ||
+		    best_handler == DLR_SEEK_INDEX_FOURCC('v', 'i', 'd', 'e') ||
+		    best_handler == handler)
+			continue;
+
+		best_handler = handler;
+		best_stbl = stbl;
+		best_stbl_length = stbl_length;
+
+		if (mdhd[0] == 1) {
+			timescale = prv_read_u32(mdhd + 20);
+			duration = prv_read_u64(mdhd + 24);
+		} else {
+			timescale = prv_read_u32(mdhd + 12);
+			duration = prv_read_u32(mdhd + 16);
+		}
+	}
+
+	if (best_stbl)
+		index = prv_mp4_index_track(best_stbl, best_stbl_length,
+					    timescale, duration);
+
+	g_free(moov);
+
+on_exit:
+
+	return index;
+}
+
+dlr_seek_index_t *dlr_seek_index_new(const gchar *file)
+{
+	dlr_seek_index_t *index = NULL;
+	guchar header[3 * 192 + 4];
+	gssize length;
+	guint packet_size;
+	struct stat buf;
+	int fd;
+
+	fd = g_open(file, O_RDONLY, 0);
+	if (fd < 0)
+		goto on_exit;
+
+	if (fstat(fd, &buf) < 0)
+		goto on_error;
+
+	length = pread(fd, header, sizeof(header), 0);
+	if (length < 8)
+		goto on_error;
+
+	/* The container is recognised from its first bytes, as MIME types
+	   are not reliable enough to tell a transport stream from a
+	   program stream. */
+
+	packet_size = prv_ts_packet_size(header, length);
+
+	if (packet_size)
+		index = prv_ts_index_new(fd, buf.st_size, packet_size);
+	else if (prv_read_u32(header + 4) ==
+		 DLR_SEEK_INDEX_FOURCC('f', 't', 'y', 'p') ||
+		 prv_read_u32(header + 4) ==
+		 DLR_SEEK_INDEX_FOURCC('m', 'o', 'o', 'v'))
+		index = prv_mp4_index_new(fd, buf.st_size);
+
+	if (index)
+		DLEYNA_LOG_DEBUG("Seek index for %s: %u entries, %"
+				 G_GINT64_FORMAT" ms", file,
+				 index->entries->len, index->duration);
+
+on_error:
+
+	(void) close(fd);
+
+on_exit:
+
+	return index;
+}
+
+dlr_seek_index_t *dlr_seek_index_new_from_string(const gchar *str)
+{
+	dlr_seek_index_t *index;
+	gchar **tokens;
+	gchar *end;
+	gint64 time;
+	goffset offset;
+	unsigned int i;
+
+	tokens = g_strsplit(str, " ", -1);
+
+	index = prv_seek_index_new();
+
+	if (!tokens[0])
+		goto on_error;
+
+	index->duration = g_ascii_strtoll(tokens[0], &end, 10);
+	if (*end)
+		goto on_error;
+
+	for (i = 1; tokens[i]; ++i) {
+		time = g_ascii_strtoll(tokens[i], &end, 10);
+		if (*end != ':')
+			goto on_error;
+
+		offset = g_ascii_strtoll(end + 1, &end, 10);
+		if (*end)
+			goto on_error;
+
+		prv_seek_index_add(index, time, offset);
+	}
+
+	index = prv_seek_index_check(index);
+
+	goto on_exit;
+
+on_error:
+
+	dlr_seek_index_unref(index);
+	index = NULL;
+
+on_exit:
+
+	g_strfreev(tokens);
+
+	return index;
+}
+
+gchar *dlr_seek_index_to_string(const dlr_seek_index_t *index)
+{
+	GString *str;
+	dlr_seek_entry_t *entry;
+	unsigned int i;
+
+	str = g_string_new("");
+	g_string_append_printf(str, "%"G_GINT64_FORMAT, index->duration);
+
+	for (i = 0; i < index->entries->len; ++i) {
+		entry = &g_array_index(index->entries, dlr_seek_entry_t, i);
+		g_string_append_printf(str, " %"G_GINT64_FORMAT":%"
+				       G_GOFFSET_FORMAT, entry->time,
+				       entry->offset);
+	}
+
+	return g_string_free(str, FALSE);
+}
+
+dlr_seek_index_t *dlr_seek_index_ref(dlr_seek_index_t *index)
+{
+	g_atomic_int_inc(&index->ref_count);
+
+	return index;
+}
+
+void dlr_seek_index_unref(dlr_seek_index_t *index)
+{
+	if (index && g_atomic_int_dec_and_test(&index->ref_count)) {
+		g_array_unref(index->entries);
+		g_free(index);
+	}
+}
+
+gint64 dlr_seek_index_get_duration(const dlr_seek_index_t *index)
+{
+	return index->duration;
+}
+
+goffset dlr_seek_index_find(const dlr_seek_index_t *index, gint64 time,
+			    gint64 *entry_time)
+{
+	dlr_seek_entry_t *entries = (dlr_seek_entry_t *)index->entries->data;
+	guint low = 0;
+	guint high = index->entries->len;
+	guint mid;
+
+	/* The last entry at or before time.  The first entry is always
+	   at time 0 so there is one. */
+
+	while (high - low > 1) {
+		mid = (low + high) / 2;
+
+		if (entries[mid].time <= time)
+			low = mid;
+		else
+			high = mid;
+	}
+
+	*entry_time = entries[low].time;
+
+	return entries[low].offset;
+}
+
+goffset dlr_seek_index_find_next(const dlr_seek_index_t *index, gint64 time,
+				 gint64 *entry_time)
+{
+	dlr_seek_entry_t *entries = (dlr_seek_entry_t *)index->entries->data;
+	guint low = 0;
+	guint high = index->entries->len;
+	guint mid;
+
+	/* The first entry after time, if any */
+
+	while (low < high) {
+		mid = (low + high) / 2;
+
+		if (entries[mid].time <= time)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	if (low == index->entries->len)
+		return -1;
+
+	*entry_time = entries[low].time;
+
+	return entries[low].offset;
+}
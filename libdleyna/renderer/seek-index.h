@@ -0,0 +1,46 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef DLR_SEEK_INDEX_H__
+#define DLR_SEEK_INDEX_H__
+
+#include <glib.h>
+
+typedef struct dlr_seek_index_t_ dlr_seek_index_t;
+
+dlr_seek_index_t *dlr_seek_index_new(const gchar *file);
+
+dlr_seek_index_t *dlr_seek_index_new_from_string(const gchar *str);
+
+gchar *dlr_seek_index_to_string(const dlr_seek_index_t *index);
+
+dlr_seek_index_t *dlr_seek_index_ref(dlr_seek_index_t *index);
+
+void dlr_seek_index_unref(dlr_seek_index_t *index);
+
+gint64 dlr_seek_index_get_duration(const dlr_seek_index_t *index);
+
+goffset dlr_seek_index_find(const dlr_seek_index_t *index, gint64 time,
+			    gint64 *entry_time);
+
+goffset dlr_seek_index_find_next(const dlr_seek_index_t *index, gint64 time,
+				 gint64 *entry_time);
+
+#endif /* DLR_SEEK_INDEX_H__ */
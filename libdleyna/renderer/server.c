@@ -66,13 +66,18 @@
 #define DLR_INTERFACE_LOST_RENDERER "LostRenderer"
 
 #define DLR_INTERFACE_HOST_FILE "HostFile"
+#define DLR_INTERFACE_HOST_FILES "HostFiles"
+#define DLR_INTERFACE_HOST_LIVE_FILE "HostLiveFile"
 #define DLR_INTERFACE_REMOVE_FILE "RemoveFile"
 
 #define DLR_INTERFACE_VERSION "Version"
 #define DLR_INTERFACE_RENDERERS "Renderers"
 
 #define DLR_INTERFACE_PATH "Path"
+#define DLR_INTERFACE_PATHS "Paths"
 #define DLR_INTERFACE_URI "Uri"
+#define DLR_INTERFACE_URIS "Uris"
+#define DLR_INTERFACE_ERRORS "Errors"
 #define DLR_INTERFACE_ID "Id"
 #define DLR_INTERFACE_METADATA "Metadata"
 
@@ -353,10 +358,37 @@ static const gchar g_server_introspection[] =
 	"      <arg type='s' name='"DLR_INTERFACE_URI"'"
 	"           direction='out'/>"
 	"    </method>"
+	"    <method name='"DLR_INTERFACE_HOST_LIVE_FILE"'>"
+	"      <arg type='s' name='"DLR_INTERFACE_PATH"'"
+	"           direction='in'/>"
+	"      <arg type='s' name='"DLR_INTERFACE_URI"'"
+	"           direction='out'/>"
+	"    </method>"
+	"    <method name='"DLR_INTERFACE_HOST_FILES"'>"
+	"      <arg type='as' name='"DLR_INTERFACE_PATHS"'"
+	"           direction='in'/>"
+	"      <arg type='as' name='"DLR_INTERFACE_URIS"'"
+	"           direction='out'/>"
+	"      <arg type='a{ss}' name='"DLR_INTERFACE_ERRORS"'"
+	"           direction='out'/>"
+	"    </method>"
 	"    <method name='"DLR_INTERFACE_REMOVE_FILE"'>"
 	"      <arg type='s' name='"DLR_INTERFACE_PATH"'"
 	"           direction='in'/>"
 	"    </method>"
+	"    <property type='t' name='"DLR_INTERFACE_PROP_REQUESTS"'"
+	"       access='read'/>"
+	"    <property type='t' name='"DLR_INTERFACE_PROP_BYTES_SENT"'"
+	"       access='read'/>"
+	"    <property type='u' name='"DLR_INTERFACE_PROP_ACTIVE_TRANSFERS"'"
+	"       access='read'/>"
+	"    <property type='t' "
+	"       name='"DLR_INTERFACE_PROP_COMPLETED_TRANSFERS"'"
+	"       access='read'/>"
+	"    <property type='t' name='"DLR_INTERFACE_PROP_ABORTED_TRANSFERS"'"
+	"       access='read'/>"
+	"    <property type='t' name='"DLR_INTERFACE_PROP_THROUGHPUT"'"
+	"       access='read'/>"
 	"  </interface>"
 	"  <interface name='"DLEYNA_SERVER_INTERFACE_RENDERER_DEVICE"'>"
 	"    <method name='"DLR_INTERFACE_CANCEL"'>"
@@ -631,6 +663,8 @@ static void prv_process_async_task(dlr_task_t *task)
 				    prv_async_task_complete);
 		break;
 	case DLR_TASK_HOST_URI:
+	case DLR_TASK_HOST_LIVE_URI:
+	case DLR_TASK_HOST_URIS:
 		dlr_upnp_host_uri(g_context.upnp, task,
 				  prv_async_task_complete);
 		break;
@@ -1012,6 +1046,12 @@ static void prv_dlr_push_host_method_call(dleyna_connector_id_t conn,
 	if (!strcmp(method, DLR_INTERFACE_HOST_FILE))
 		task = dlr_task_host_uri_new(invocation, object, sender,
 					     parameters);
+	else if (!strcmp(method, DLR_INTERFACE_HOST_LIVE_FILE))
+		task = dlr_task_host_live_uri_new(invocation, object, sender,
+						  parameters);
+	else if (!strcmp(method, DLR_INTERFACE_HOST_FILES))
+		task = dlr_task_host_uris_new(invocation, object, sender,
+					      parameters);
 	else if (!strcmp(method, DLR_INTERFACE_REMOVE_FILE))
 		task = dlr_task_remove_uri_new(invocation, object, sender,
 					       parameters);
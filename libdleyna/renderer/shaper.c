@@ -0,0 +1,405 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <glib.h>
+
+#include "shaper.h"
+
+#define DLR_SHAPER_MIN_QUANTUM 4096
+#define DLR_SHAPER_QUANTA_PER_SECOND 16
+#define DLR_SHAPER_BURST_DIVISOR 4
+
+typedef struct dlr_shaper_bucket_t_ dlr_shaper_bucket_t;
+struct dlr_shaper_bucket_t_ {
+	guint rate;
+	gint64 tokens;
+	gint64 capacity;
+	gint64 stamp;
+};
+
+typedef struct dlr_shaper_client_t_ dlr_shaper_client_t;
+struct dlr_shaper_client_t_ {
+	dlr_shaper_bucket_t bucket;
+	guint flows;
+};
+
+/* Shapers and their flows are only used from the host thread. */
+
+struct dlr_shaper_t_ {
+	guint ref_count;
+	GMainContext *context;
+	dlr_shaper_bucket_t bucket;
+	guint client_rate;
+	guint flow_rate;
+	gsize quantum;
+	GHashTable *clients;
+	GList *pending;
+	guint64 virtual_time;
+	GSource *timer;
+	gint64 timer_due;
+};
+
+struct dlr_shaper_flow_t_ {
+	dlr_shaper_t *shaper;
+	gchar *client_name;
+	dlr_shaper_client_t *client;
+	dlr_shaper_bucket_t bucket;
+	gsize wanted;
+	guint64 finish;
+	GList *link;
+	dlr_shaper_grant_cb_t cb;
+	gpointer user_data;
+};
+
+static void prv_bucket_init(dlr_shaper_bucket_t *bucket, guint rate,
+			    gsize quantum)
+{
+	/* A bucket holds at most a fraction of a second of data, but
+	   always enough for one quantum. */
+
+	bucket->rate = rate;
+	bucket->capacity = MAX(rate / DLR_SHAPER_BURST_DIVISOR, quantum);
+	bucket->tokens = bucket->capacity;
+	bucket->stamp = g_get_monotonic_time();
+}
+
+static void prv_bucket_refill(dlr_shaper_bucket_t *bucket, gint64 now)
+{
+	gint64 elapsed;
+
+	if (!bucket->rate)
+		goto on_exit;
+
+	elapsed = MIN(now - bucket->stamp, G_USEC_PER_SEC);
+	bucket->tokens = MIN(bucket->capacity, bucket->tokens +
+			     elapsed * bucket->rate / G_USEC_PER_SEC);
+	bucket->stamp = now;
+
+on_exit:
+
+	return;
+}
+
+static gint64 prv_bucket_delay(const dlr_shaper_bucket_t *bucket)
+{
+	/* Time in microseconds until the bucket is no longer empty.  A
+	   bucket may run into debt by up to one quantum, which is then
+	   paid back before anything else is sent. */
+
+	if (!bucket->rate || bucket->tokens > 0)
+		return 0;
+
+	return ((1 - bucket->tokens) * G_USEC_PER_SEC + bucket->rate - 1) /
+		bucket->rate;
+}
+
+static void prv_bucket_take(dlr_shaper_bucket_t *bucket, gint64 bytes)
+{
+	if (bucket->rate)
+		bucket->tokens = MIN(bucket->capacity, bucket->tokens - bytes);
+}
+
+static gint64 prv_flow_delay(dlr_shaper_flow_t *flow, gint64 now)
+{
+	dlr_shaper_t *shaper = flow->shaper;
+	gint64 delay;
+
+	prv_bucket_refill(&shaper->bucket, now);
+	prv_bucket_refill(&flow->client->bucket, now);
+	prv_bucket_refill(&flow->bucket, now);
+
+	delay = prv_bucket_delay(&shaper->bucket);
+	delay = MAX(delay, prv_bucket_delay(&flow->client->bucket));
+	delay = MAX(delay, prv_bucket_delay(&flow->bucket));
+
+	return delay;
+}
+
+static gsize prv_flow_grant(dlr_shaper_flow_t *flow)
+{
+	dlr_shaper_t *shaper = flow->shaper;
+	gsize bytes = flow->wanted;
+
+	shaper->pending = g_list_delete_link(shaper->pending, flow->link);
+	flow->link = NULL;
+	flow->wanted = 0;
+
+	/* Flows that were blocked by their own limits may be granted out
+	   of finish tag order, and must not move the clock back. */
+
+	shaper->virtual_time = MAX(shaper->virtual_time, flow->finish);
+
+	prv_bucket_take(&shaper->bucket, bytes);
+	prv_bucket_take(&flow->client->bucket, bytes);
+	prv_bucket_take(&flow->bucket, bytes);
+
+	return bytes;
+}
+
+static dlr_shaper_flow_t *prv_next_flow(dlr_shaper_t *shaper, gint64 now,
+					gint64 *delay)
+{
+	dlr_shaper_flow_t *retval = NULL;
+	dlr_shaper_flow_t *flow;
+	GList *l;
+	gint64 flow_delay;
+
+	/* Of the flows that can send now, the one with the lowest finish
+	   tag goes first.  Otherwise delay is set to the time until the
+	   first of them can. */
+
+	*delay = G_MAXINT64;
+
+	for (l = shaper->pending; l; l = l->next) {
+		flow = l->data;
+		flow_delay = prv_flow_delay(flow, now);
+
+		if (flow_delay > 0)
+			*delay = MIN(*delay, flow_delay);
+		else if (!retval || flow->finish < retval->finish)
+			retval = flow;
+	}
+
+	return retval;
+}
+
+static gboolean prv_shaper_timer_cb(gpointer user_data);
+
+static void prv_shaper_arm(dlr_shaper_t *shaper, gint64 now, gint64 delay)
+{
+	if (shaper->timer) {
+		if (shaper->timer_due <= now + delay)
+			goto on_exit;
+
+		g_source_destroy(shaper->timer);
+		g_source_unref(shaper->timer);
+	}
+
+	shaper->timer_due = now + delay;
+	shaper->timer = g_timeout_source_new((delay + 999) / 1000);
+	g_source_set_callback(shaper->timer, prv_shaper_timer_cb, shaper,
+			      NULL);
+	(void) g_source_attach(shaper->timer, shaper->context);
+
+on_exit:
+
+	return;
+}
+
+static gboolean prv_shaper_timer_cb(gpointer user_data)
+{
+	dlr_shaper_t *shaper = user_data;
+	dlr_shaper_flow_t *flow;
+	gsize bytes;
+	gint64 now;
+	gint64 delay;
+
+	g_source_unref(shaper->timer);
+	shaper->timer = NULL;
+
+	/* The callbacks may request more data or delete flows, so the
+	   next flow is looked for afresh each time. */
+
+	(void) dlr_shaper_ref(shaper);
+
+	now = g_get_monotonic_time();
+
+	while ((flow = prv_next_flow(shaper, now, &delay))) {
+		bytes = prv_flow_grant(flow);
+		flow->cb(bytes, flow->user_data);
+	}
+
+	if (shaper->pending)
+		prv_shaper_arm(shaper, now, delay);
+
+	dlr_shaper_unref(shaper);
+
+	return FALSE;
+}
+
+dlr_shaper_t *dlr_shaper_new(GMainContext *context, guint rate,
+			     guint client_rate, guint flow_rate)
+{
+	dlr_shaper_t *shaper;
+	guint min_rate = G_MAXUINT;
+
+	shaper = g_new0(dlr_shaper_t, 1);
+	shaper->ref_count = 1;
+	shaper->context = g_main_context_ref(context);
+	shaper->client_rate = client_rate;
+	shaper->flow_rate = flow_rate;
+	shaper->clients = g_hash_table_new_full(g_str_hash, g_str_equal,
+						g_free, g_free);
+
+	/* Data is handed out in quanta small enough for the slowest
+	   bucket to be refilled several times a second, so that the
+	   transfers it limits flow smoothly. */
+
+	if (rate)
+		min_rate = MIN(min_rate, rate);
+	if (client_rate)
+		min_rate = MIN(min_rate, client_rate);
+	if (flow_rate)
+		min_rate = MIN(min_rate, flow_rate);
+
+	shaper->quantum = MAX(min_rate / DLR_SHAPER_QUANTA_PER_SECOND,
+			      DLR_SHAPER_MIN_QUANTUM);
+
+	prv_bucket_init(&shaper->bucket, rate, shaper->quantum);
+
+	return shaper;
+}
+
+dlr_shaper_t *dlr_shaper_ref(dlr_shaper_t *shaper)
+{
+	shaper->ref_count++;
+
+	return shaper;
+}
+
+void dlr_shaper_unref(dlr_shaper_t *shaper)
+{
+	if (--shaper->ref_count > 0)
+		goto on_exit;
+
+	if (shaper->timer) {
+		g_source_destroy(shaper->timer);
+		g_source_unref(shaper->timer);
+	}
+
+	g_list_free(shaper->pending);
+	g_hash_table_unref(shaper->clients);
+	g_main_context_unref(shaper->context);
+	g_free(shaper);
+
+on_exit:
+
+	return;
+}
+
+dlr_shaper_flow_t *dlr_shaper_flow_new(dlr_shaper_t *shaper,
+				       const gchar *client,
+				       dlr_shaper_grant_cb_t cb,
+				       gpointer user_data)
+{
+	dlr_shaper_flow_t *flow;
+
+	flow = g_new0(dlr_shaper_flow_t, 1);
+	flow->shaper = dlr_shaper_ref(shaper);
+	flow->client_name = g_strdup(client);
+	flow->cb = cb;
+	flow->user_data = user_data;
+
+	flow->client = g_hash_table_lookup(shaper->clients, client);
+	if (!flow->client) {
+		flow->client = g_new0(dlr_shaper_client_t, 1);
+		prv_bucket_init(&flow->client->bucket, shaper->client_rate,
+				shaper->quantum);
+		g_hash_table_insert(shaper->clients, g_strdup(client),
+				    flow->client);
+	}
+
+	flow->client->flows++;
+
+	prv_bucket_init(&flow->bucket, shaper->flow_rate, shaper->quantum);
+
+	/* A new flow starts level with the ones already running, rather
+	   than being owed everything they have sent so far. */
+
+	flow->finish = shaper->virtual_time;
+
+	return flow;
+}
+
+void dlr_shaper_flow_delete(dlr_shaper_flow_t *flow)
+{
+	dlr_shaper_t *shaper;
+
+	if (!flow)
+		goto on_exit;
+
+	shaper = flow->shaper;
+
+	if (flow->link)
+		shaper->pending = g_list_delete_link(shaper->pending,
+						     flow->link);
+
+	if (--flow->client->flows == 0)
+		(void) g_hash_table_remove(shaper->clients, flow->client_name);
+
+	g_free(flow->client_name);
+	g_free(flow);
+
+	dlr_shaper_unref(shaper);
+
+on_exit:
+
+	return;
+}
+
+gsize dlr_shaper_flow_request(dlr_shaper_flow_t *flow, gsize bytes)
+{
+	dlr_shaper_t *shaper = flow->shaper;
+	dlr_shaper_flow_t *next;
+	gsize retval = 0;
+	gint64 now;
+	gint64 delay;
+
+	if (flow->link)
+		goto on_exit;
+
+	/* Each client gets an equal share of the bandwidth however many
+	   connections it has open, so the finish tag of a flow advances
+	   by its chunk size times the number of flows of its client. */
+
+	flow->wanted = MIN(bytes, shaper->quantum);
+	flow->finish = MAX(shaper->virtual_time, flow->finish) +
+		flow->wanted * flow->client->flows;
+	shaper->pending = g_list_prepend(shaper->pending, flow);
+	flow->link = shaper->pending;
+
+	/* The flow is granted its chunk straight away if it is next in
+	   line.  Otherwise the flows ahead of it are served from the
+	   timer, and it is called back when its turn comes. */
+
+	now = g_get_monotonic_time();
+	next = prv_next_flow(shaper, now, &delay);
+
+	if (next == flow)
+		retval = prv_flow_grant(flow);
+	else
+		prv_shaper_arm(shaper, now, next ? 0 : delay);
+
+on_exit:
+
+	return retval;
+}
+
+void dlr_shaper_flow_refund(dlr_shaper_flow_t *flow, gsize bytes)
+{
+	dlr_shaper_t *shaper = flow->shaper;
+
+	/* Data that was granted but could not be sent, for example
+	   because a pipe had less to give, is not charged for. */
+
+	prv_bucket_take(&shaper->bucket, -(gint64) bytes);
+	prv_bucket_take(&flow->client->bucket, -(gint64) bytes);
+	prv_bucket_take(&flow->bucket, -(gint64) bytes);
+}
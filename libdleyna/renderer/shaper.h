@@ -0,0 +1,54 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef DLR_SHAPER_H__
+#define DLR_SHAPER_H__
+
+#include <glib.h>
+
+/* Shares the bandwidth of a push host server between the transfers it
+   is running.  Each transfer is a flow, which asks for permission
+   before sending each chunk.  Rates are in bytes per second, with 0
+   meaning unlimited. */
+
+typedef struct dlr_shaper_t_ dlr_shaper_t;
+typedef struct dlr_shaper_flow_t_ dlr_shaper_flow_t;
+
+typedef void (*dlr_shaper_grant_cb_t)(gsize bytes, gpointer user_data);
+
+dlr_shaper_t *dlr_shaper_new(GMainContext *context, guint rate,
+			     guint client_rate, guint flow_rate);
+
+dlr_shaper_t *dlr_shaper_ref(dlr_shaper_t *shaper);
+
+void dlr_shaper_unref(dlr_shaper_t *shaper);
+
+dlr_shaper_flow_t *dlr_shaper_flow_new(dlr_shaper_t *shaper,
+				       const gchar *client,
+				       dlr_shaper_grant_cb_t cb,
+				       gpointer user_data);
+
+void dlr_shaper_flow_delete(dlr_shaper_flow_t *flow);
+
+gsize dlr_shaper_flow_request(dlr_shaper_flow_t *flow, gsize bytes);
+
+void dlr_shaper_flow_refund(dlr_shaper_flow_t *flow, gsize bytes);
+
+#endif /* DLR_SHAPER_H__ */
@@ -119,10 +119,15 @@ static void prv_dlr_task_delete(dlr_task_t *task)
 		g_free(task->ut.open_uri.metadata);
 		break;
 	case DLR_TASK_HOST_URI:
+	case DLR_TASK_HOST_LIVE_URI:
 	case DLR_TASK_REMOVE_URI:
 		g_free(task->ut.host_uri.uri);
 		g_free(task->ut.host_uri.client);
 		break;
+	case DLR_TASK_HOST_URIS:
+		g_strfreev(task->ut.host_uris.uris);
+		g_free(task->ut.host_uris.client);
+		break;
 	case DLR_TASK_GET_ICON:
 		g_free(task->ut.get_icon.mime_type);
 		g_free(task->ut.get_icon.resolution);
@@ -395,6 +400,43 @@ dlr_task_t *dlr_task_host_uri_new(dleyna_connector_msg_id_t invocation,
 	return task;
 }
 
+dlr_task_t *dlr_task_host_live_uri_new(dleyna_connector_msg_id_t invocation,
+				       const gchar *path,
+				       const gchar *sender,
+				       GVariant *parameters)
+{
+	dlr_task_t *task;
+
+	task = prv_device_task_new(DLR_TASK_HOST_LIVE_URI, invocation, path,
+				   "(@s)");
+
+	g_variant_get(parameters, "(s)", &task->ut.host_uri.uri);
+	g_strstrip(task->ut.host_uri.uri);
+	task->ut.host_uri.client = g_strdup(sender);
+
+	return task;
+}
+
+dlr_task_t *dlr_task_host_uris_new(dleyna_connector_msg_id_t invocation,
+				   const gchar *path,
+				   const gchar *sender,
+				   GVariant *parameters)
+{
+	dlr_task_t *task;
+	unsigned int i;
+
+	task = prv_device_task_new(DLR_TASK_HOST_URIS, invocation, path,
+				   "(@as@a{ss})");
+	task->multiple_retvals = TRUE;
+
+	g_variant_get(parameters, "(^as)", &task->ut.host_uris.uris);
+	for (i = 0; task->ut.host_uris.uris[i]; ++i)
+		g_strstrip(task->ut.host_uris.uris[i]);
+	task->ut.host_uris.client = g_strdup(sender);
+
+	return task;
+}
+
 dlr_task_t *dlr_task_remove_uri_new(dleyna_connector_msg_id_t invocation,
 				    const gchar *path,
 				    const gchar *sender,
@@ -53,6 +53,8 @@ enum dlr_task_type_t_ {
 	DLR_TASK_SET_BYTE_POSITION,
 	DLR_TASK_GOTO_TRACK,
 	DLR_TASK_HOST_URI,
+	DLR_TASK_HOST_LIVE_URI,
+	DLR_TASK_HOST_URIS,
 	DLR_TASK_REMOVE_URI,
 	DLR_TASK_GET_ICON,
 	DLR_TASK_MANAGER_GET_ALL_PROPS,
@@ -103,6 +105,12 @@ struct dlr_task_host_uri_t_ {
 	gchar *client;
 };
 
+typedef struct dlr_task_host_uris_t_ dlr_task_host_uris_t;
+struct dlr_task_host_uris_t_ {
+	gchar **uris;
+	gchar *client;
+};
+
 typedef struct dlr_task_get_icon_t_ dlr_task_get_icon_t;
 struct dlr_task_get_icon_t_ {
 	gchar *mime_type;
@@ -125,6 +133,7 @@ struct dlr_task_t_ {
 		dlr_task_set_prop_t set_prop;
 		dlr_task_open_uri_t open_uri;
 		dlr_task_host_uri_t host_uri;
+		dlr_task_host_uris_t host_uris;
 		dlr_task_seek_t seek;
 		dlr_task_get_icon_t get_icon;
 	} ut;
@@ -199,6 +208,14 @@ dlr_task_t *dlr_task_host_uri_new(dleyna_connector_msg_id_t invocation,
 				  const gchar *path, const gchar *sender,
 				  GVariant *parameters);
 
+dlr_task_t *dlr_task_host_live_uri_new(dleyna_connector_msg_id_t invocation,
+				       const gchar *path, const gchar *sender,
+				       GVariant *parameters);
+
+dlr_task_t *dlr_task_host_uris_new(dleyna_connector_msg_id_t invocation,
+				   const gchar *path, const gchar *sender,
+				   GVariant *parameters);
+
 dlr_task_t *dlr_task_remove_uri_new(dleyna_connector_msg_id_t invocation,
 				    const gchar *path, const gchar *sender,
 				    GVariant *parameters);
@@ -34,6 +34,7 @@
 #include "device.h"
 #include "host-service.h"
 #include "prop-defs.h"
+#include "renderer-settings.h"
 #include "upnp.h"
 
 struct dlr_upnp_t_ {
@@ -46,6 +47,7 @@ struct dlr_upnp_t_ {
 	GHashTable *server_udn_map;
 	GHashTable *server_uc_map;
 	dlr_host_service_t *host_service;
+	dlr_renderer_settings_t settings;
 };
 
 /* Private structure used in service task */
@@ -184,8 +186,10 @@ static void prv_server_available_cb(GUPnPControlPoint *cp,
 
 		queue_id = prv_create_device_queue(&priv_t);
 
-		device = dlr_device_new(upnp->connection, proxy, ip_address,
-					udn, upnp->interface_info, queue_id);
+		device = dlr_device_new(
+				upnp->connection, proxy, ip_address, udn,
+				upnp->interface_info, queue_id,
+				upnp->settings.properties_changed_delay);
 
 		prv_update_device_context(priv_t, upnp, udn, device, ip_address,
 					  queue_id);
@@ -382,7 +386,9 @@ dlr_upnp_t *dlr_upnp_new(dleyna_connector_id_t connection,
 			 G_CALLBACK(prv_on_context_available),
 			 upnp);
 
-	dlr_host_service_new(&upnp->host_service, push_host_port);
+	dlr_renderer_settings_load(&upnp->settings);
+	dlr_host_service_new(&upnp->host_service, push_host_port,
+			     &upnp->settings);
 
 	return upnp;
 }
@@ -391,6 +397,7 @@ void dlr_upnp_delete(dlr_upnp_t *upnp)
 {
 	if (upnp) {
 		dlr_host_service_delete(upnp->host_service);
+		dlr_renderer_settings_clear(&upnp->settings);
 		g_object_unref(upnp->context_manager);
 		g_hash_table_unref(upnp->server_udn_map);
 		g_hash_table_unref(upnp->server_uc_map);
@@ -471,7 +478,7 @@ void dlr_upnp_get_prop(dlr_upnp_t *upnp, dlr_task_t *task,
 
 		(void) g_idle_add(dlr_async_task_complete, cb_data);
 	} else {
-		dlr_device_get_prop(device, task, cb);
+		dlr_device_get_prop(device, task, upnp->host_service, cb);
 	}
 
 	DLEYNA_LOG_DEBUG("Exit");
@@ -498,7 +505,8 @@ void dlr_upnp_get_all_props(dlr_upnp_t *upnp, dlr_task_t *task,
 
 		(void) g_idle_add(dlr_async_task_complete, cb_data);
 	} else {
-		dlr_device_get_all_props(device, task, cb);
+		dlr_device_get_all_props(device, task, upnp->host_service,
+					 cb);
 	}
 
 	DLEYNA_LOG_DEBUG("Exit");
@@ -666,7 +674,7 @@ void dlr_upnp_open_uri(dlr_upnp_t *upnp, dlr_task_t *task,
 
 		(void) g_idle_add(dlr_async_task_complete, cb_data);
 	} else {
-		dlr_device_open_uri(device, task, cb);
+		dlr_device_open_uri(device, task, upnp->host_service, cb);
 	}
 
 	DLEYNA_LOG_DEBUG("Exit");
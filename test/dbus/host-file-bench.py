@@ -0,0 +1,81 @@
+# host-file-bench
+#
+# Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify it
+# under the terms and conditions of the GNU Lesser General Public License,
+# version 2.1, as published by the Free Software Foundation.
+#
+# This program is distributed in the hope it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+#
+
+# Measures the time taken by HostFile for each file in a directory of
+# sample media files.  The files are copied to a temporary directory
+# first so that every run probes them from scratch rather than being
+# answered from the profile cache.
+#
+# Usage: host-file-bench.py <renderer object path> <media directory>
+
+from __future__ import print_function
+
+import os
+import sys
+import shutil
+import tempfile
+import time
+import dbus
+
+if __name__ == '__main__':
+    if len(sys.argv) < 3:
+        print("Usage: " + sys.argv[0] + " <renderer path> <media directory>")
+        sys.exit(1)
+
+    bus = dbus.SessionBus()
+    host = dbus.Interface(bus.get_object('com.intel.dleyna-renderer',
+                                         sys.argv[1]),
+                          'com.intel.dLeynaRenderer.PushHost')
+
+    temp_dir = tempfile.mkdtemp()
+    hosted = []
+    timings = []
+
+    try:
+        for name in sorted(os.listdir(sys.argv[2])):
+            src = os.path.join(sys.argv[2], name)
+            if not os.path.isfile(src):
+                continue
+            fname = os.path.join(temp_dir, name)
+            shutil.copyfile(src, fname)
+
+            start = time.time()
+            try:
+                host.HostFile(fname)
+                hosted.append(fname)
+            except dbus.DBusException as err:
+                print("%s: %s" % (name, err.get_dbus_message()))
+                continue
+            elapsed = (time.time() - start) * 1000.0
+            timings.append(elapsed)
+            print("%-40s %10.1f ms" % (name, elapsed))
+
+        if timings:
+            timings.sort()
+            print("")
+            print("files:  %d" % len(timings))
+            print("mean:   %.1f ms" % (sum(timings) / len(timings)))
+            print("median: %.1f ms" % timings[len(timings) // 2])
+            print("max:    %.1f ms" % timings[-1])
+    finally:
+        for fname in hosted:
+            try:
+                host.RemoveFile(fname)
+            except dbus.DBusException:
+                pass
+        shutil.rmtree(temp_dir)
@@ -0,0 +1,107 @@
+# host-load-bench
+#
+# Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify it
+# under the terms and conditions of the GNU Lesser General Public License,
+# version 2.1, as published by the Free Software Foundation.
+#
+# This program is distributed in the hope it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+#
+
+# Measures D-Bus call latency on a renderer while a hosted file is being
+# downloaded by a number of concurrent HTTP clients, to check that
+# serving files does not hold up D-Bus processing.
+#
+# Usage: host-load-bench.py <renderer object path> <file> [clients]
+
+from __future__ import print_function
+
+import sys
+import threading
+import time
+import dbus
+
+try:
+    import urllib2 as urlrequest
+except ImportError:
+    import urllib.request as urlrequest
+
+CALLS = 200
+CHUNK = 64 * 1024
+
+def measure(props):
+    timings = []
+    for i in range(CALLS):
+        start = time.time()
+        props.GetAll('org.mpris.MediaPlayer2.Player')
+        timings.append((time.time() - start) * 1000.0)
+    timings.sort()
+    return (timings[len(timings) // 2],
+            timings[int(len(timings) * 0.95)],
+            timings[-1])
+
+def download(url, stop, totals, index):
+    while not stop.is_set():
+        response = urlrequest.urlopen(url)
+        while not stop.is_set():
+            data = response.read(CHUNK)
+            if not data:
+                break
+            totals[index] += len(data)
+        response.close()
+
+if __name__ == '__main__':
+    if len(sys.argv) < 3:
+        print("Usage: " + sys.argv[0] + " <renderer path> <file> [clients]")
+        sys.exit(1)
+
+    clients = 4
+    if len(sys.argv) > 3:
+        clients = int(sys.argv[3])
+
+    bus = dbus.SessionBus()
+    obj = bus.get_object('com.intel.dleyna-renderer', sys.argv[1])
+    host = dbus.Interface(obj, 'com.intel.dLeynaRenderer.PushHost')
+    props = dbus.Interface(obj, 'org.freedesktop.DBus.Properties')
+
+    url = str(host.HostFile(sys.argv[2]))
+
+    try:
+        print("%-10s %10s %10s %10s" % ("", "median ms", "p95 ms", "max ms"))
+        print("%-10s %10.2f %10.2f %10.2f" % (("idle",) + measure(props)))
+
+        stop = threading.Event()
+        totals = [0] * clients
+        threads = []
+        for i in range(clients):
+            t = threading.Thread(target=download,
+                                 args=(url, stop, totals, i))
+            t.daemon = True
+            t.start()
+            threads.append(t)
+
+        time.sleep(1)
+        served = sum(totals)
+        start = time.time()
+        result = measure(props)
+        elapsed = time.time() - start
+        served = sum(totals) - served
+        print("%-10s %10.2f %10.2f %10.2f" % (("loaded",) + result))
+
+        stop.set()
+        for t in threads:
+            t.join()
+
+        print("")
+        print("%d clients, %.1f MB/s served while measuring" %
+              (clients, served / elapsed / (1024 * 1024)))
+    finally:
+        host.RemoveFile(sys.argv[2])
@@ -0,0 +1,92 @@
+# host-lookup-bench
+#
+# Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify it
+# under the terms and conditions of the GNU Lesser General Public License,
+# version 2.1, as published by the Free Software Foundation.
+#
+# This program is distributed in the hope it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+#
+
+# Measures the cost of a HEAD request on the push host server as the
+# number of hosted files grows.  With the URL index in place the time per
+# request should stay flat.
+#
+# Usage: host-lookup-bench.py <renderer object path> [max files]
+
+from __future__ import print_function
+
+import os
+import sys
+import shutil
+import tempfile
+import time
+import dbus
+
+try:
+    import httplib
+    import urlparse
+except ImportError:
+    import http.client as httplib
+    import urllib.parse as urlparse
+
+REQUESTS_PER_STEP = 200
+
+def head(url):
+    parts = urlparse.urlparse(url)
+    conn = httplib.HTTPConnection(parts.hostname, parts.port)
+    conn.request("HEAD", parts.path)
+    conn.getresponse().read()
+    conn.close()
+
+def time_lookups(urls):
+    start = time.time()
+    for i in range(REQUESTS_PER_STEP):
+        head(urls[(i * 7919) % len(urls)])
+    return (time.time() - start) * 1000.0 / REQUESTS_PER_STEP
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        print("Usage: " + sys.argv[0] + " <renderer path> [max files]")
+        sys.exit(1)
+
+    max_files = 4096
+    if len(sys.argv) > 2:
+        max_files = int(sys.argv[2])
+
+    bus = dbus.SessionBus()
+    host = dbus.Interface(bus.get_object('com.intel.dleyna-renderer',
+                                         sys.argv[1]),
+                          'com.intel.dLeynaRenderer.PushHost')
+
+    temp_dir = tempfile.mkdtemp()
+    files = []
+    urls = []
+    step = 16
+
+    try:
+        print("%8s %12s" % ("files", "ms/request"))
+        while len(files) < max_files:
+            while len(files) < step:
+                fname = os.path.join(temp_dir, "file-%d.txt" % len(files))
+                with open(fname, "w") as f:
+                    f.write("x")
+                files.append(fname)
+                urls.append(str(host.HostFile(fname)))
+            print("%8d %12.3f" % (len(files), time_lookups(urls)))
+            step *= 2
+    finally:
+        for fname in files:
+            try:
+                host.RemoveFile(fname)
+            except dbus.DBusException:
+                pass
+        shutil.rmtree(temp_dir)
@@ -0,0 +1,353 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*
+ * Compares the cost of extracting the variables that dleyna-renderer
+ * follows from LastChange events, using the GUPnP-AV parser, which
+ * builds a DOM for each event, and the streaming parser used by the
+ * devices.  Both parsers are first checked to extract the same values
+ * from each event, and the program fails if they do not.
+ *
+ * Build with "make test/last-change-bench".
+ *
+ * Usage: last-change-bench [iterations] [captured LastChange files...]
+ *
+ * Each file holds the value of one LastChange event, as received from a
+ * renderer.  Without files a set of typical events is used.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib.h>
+#include <libgupnp-av/gupnp-av.h>
+
+#include "last-change.h"
+
+#define DEFAULT_ITERATIONS 20000
+
+static const gchar *const g_av_vars[] = {
+	"CurrentTrackMetaData",
+	"CurrentTransportActions",
+	"TransportPlaySpeed",
+	"TransportState",
+	"CurrentTrackDuration",
+	"CurrentTrackURI",
+	"NumberOfTracks",
+	"CurrentTrack",
+	NULL
+};
+
+static const GType g_av_types[] = {
+	G_TYPE_STRING,
+	G_TYPE_STRING,
+	G_TYPE_STRING,
+	G_TYPE_STRING,
+	G_TYPE_STRING,
+	G_TYPE_STRING,
+	G_TYPE_UINT,
+	G_TYPE_UINT
+};
+
+static const gchar *const g_rc_vars[] = {
+	"Volume",
+	"Mute",
+	NULL
+};
+
+static const GType g_rc_types[] = {
+	G_TYPE_UINT,
+	G_TYPE_BOOLEAN
+};
+
+static const gchar *const g_samples[] = {
+	/* Track change, with metadata */
+	"<Event xmlns=\"urn:schemas-upnp-org:metadata-1-0/AVT/\">"
+	"<InstanceID val=\"0\">"
+	"<TransportState val=\"PLAYING\"/>"
+	"<TransportStatus val=\"OK\"/>"
+	"<TransportPlaySpeed val=\"1\"/>"
+	"<NumberOfTracks val=\"1\"/>"
+	"<CurrentTrack val=\"1\"/>"
+	"<CurrentTrackDuration val=\"0:04:12.000\"/>"
+	"<CurrentMediaDuration val=\"0:04:12.000\"/>"
+	"<CurrentTrackURI "
+	"val=\"http://192.168.1.10:8080/dleynarenderer/12.mp3\"/>"
+	"<AVTransportURI "
+	"val=\"http://192.168.1.10:8080/dleynarenderer/12.mp3\"/>"
+	"<CurrentTransportActions val=\"Play,Stop,Pause,Seek,Next,Previous\"/>"
+	"<CurrentTrackMetaData val=\"&lt;DIDL-Lite "
+	"xmlns=&quot;urn:schemas-upnp-org:metadata-1-0/DIDL-Lite/&quot; "
+	"xmlns:dc=&quot;http://purl.org/dc/elements/1.1/&quot; "
+	"xmlns:upnp=&quot;urn:schemas-upnp-org:metadata-1-0/upnp/&quot;&gt;"
+	"&lt;item id=&quot;12&quot; parentID=&quot;0&quot; "
+	"restricted=&quot;1&quot;&gt;"
+	"&lt;dc:title&gt;Some Song&lt;/dc:title&gt;"
+	"&lt;upnp:artist&gt;Some Artist&lt;/upnp:artist&gt;"
+	"&lt;upnp:album&gt;Some Album&lt;/upnp:album&gt;"
+	"&lt;upnp:class&gt;object.item.audioItem.musicTrack"
+	"&lt;/upnp:class&gt;"
+	"&lt;res protocolInfo=&quot;http-get:*:audio/mpeg:"
+	"DLNA.ORG_PN=MP3;DLNA.ORG_OP=01&quot; duration=&quot;0:04:12.000"
+	"&quot;&gt;http://192.168.1.10:8080/dleynarenderer/12.mp3"
+	"&lt;/res&gt;&lt;/item&gt;&lt;/DIDL-Lite&gt;\"/>"
+	"</InstanceID>"
+	"</Event>",
+
+	/* State change only */
+	"<Event xmlns=\"urn:schemas-upnp-org:metadata-1-0/AVT/\">"
+	"<InstanceID val=\"0\">"
+	"<TransportState val=\"PAUSED_PLAYBACK\"/>"
+	"<CurrentTransportActions val=\"Play,Stop,Seek\"/>"
+	"</InstanceID>"
+	"</Event>",
+
+	/* Several instances, ours last */
+	"<Event xmlns=\"urn:schemas-upnp-org:metadata-1-0/AVT/\">"
+	"<InstanceID val=\"1\">"
+	"<TransportState val=\"STOPPED\"/>"
+	"</InstanceID>"
+	"<InstanceID val=\"0\">"
+	"<TransportState val=\"TRANSITIONING\"/>"
+	"<CurrentTrack val=\"2\"/>"
+	"</InstanceID>"
+	"</Event>"
+};
+
+/* RenderingControl events are only used to check the parsers */
+
+static const gchar *const g_rc_samples[] = {
+	/* Master channel, mute given as a word */
+	"<Event xmlns=\"urn:schemas-upnp-org:metadata-1-0/RCS/\">"
+	"<InstanceID val=\"0\">"
+	"<Volume channel=\"Master\" val=\"42\"/>"
+	"<Mute val=\"true\"/>"
+	"</InstanceID>"
+	"</Event>",
+
+	/* Mute given as a number */
+	"<Event xmlns=\"urn:schemas-upnp-org:metadata-1-0/RCS/\">"
+	"<InstanceID val=\"0\">"
+	"<Mute channel=\"Master\" val=\"0\"/>"
+	"<Volume val=\"7\"/>"
+	"</InstanceID>"
+	"</Event>"
+};
+
+static gboolean prv_check_variable(GUPnPLastChangeParser *parser,
+				   dlr_last_change_t *lc, const gchar *event,
+				   const gchar *name, guint variable,
+				   GType type)
+{
+	gchar *expected = NULL;
+	const gchar *value;
+	guint expected_uint = 0;
+	guint uint_value = 0;
+	gboolean expected_bool = FALSE;
+	gboolean bool_value = FALSE;
+	gboolean retval = FALSE;
+
+	/* The variable is read as a string first, to tell whether it is
+	   present at all, and then as its own type. */
+
+	(void) gupnp_last_change_parser_parse_last_change(
+		parser, 0, event, NULL, name, G_TYPE_STRING, &expected, NULL);
+
+	value = dlr_last_change_get_string(lc, variable);
+
+	if (g_strcmp0(expected, value))
+		goto on_exit;
+
+	if (!expected || type == G_TYPE_STRING) {
+		retval = TRUE;
+	} else if (type == G_TYPE_UINT) {
+		(void) gupnp_last_change_parser_parse_last_change(
+			parser, 0, event, NULL, name, G_TYPE_UINT,
+			&expected_uint, NULL);
+
+		retval = dlr_last_change_get_uint(lc, variable, &uint_value) &&
+			uint_value == expected_uint;
+	} else if (type == G_TYPE_BOOLEAN) {
+		(void) gupnp_last_change_parser_parse_last_change(
+			parser, 0, event, NULL, name, G_TYPE_BOOLEAN,
+			&expected_bool, NULL);
+
+		retval = dlr_last_change_get_bool(lc, variable, &bool_value) &&
+			!bool_value == !expected_bool;
+	}
+
+on_exit:
+
+	if (!retval)
+		fprintf(stderr, "%s differs: \"%s\" from gupnp-av, "
+			"\"%s\" from the streaming parser\n", name,
+			expected ? expected : "(none)",
+			value ? value : "(none)");
+
+	g_free(expected);
+
+	return retval;
+}
+
+static gboolean prv_check(const gchar *const *events, guint count,
+			  const gchar *const *variables, const GType *types)
+{
+	GUPnPLastChangeParser *parser;
+	dlr_last_change_t *lc;
+	gboolean retval = TRUE;
+	guint i;
+	guint j;
+
+	parser = gupnp_last_change_parser_new();
+	lc = dlr_last_change_new(variables);
+
+	/* An event without our instance leaves every variable unset in
+	   both parsers, so the result of the parse is not compared. */
+
+	for (i = 0; i < count; ++i) {
+		(void) dlr_last_change_parse(lc, events[i], 0);
+
+		for (j = 0; variables[j]; ++j)
+			if (!prv_check_variable(parser, lc, events[i],
+						variables[j], j, types[j]))
+				retval = FALSE;
+	}
+
+	dlr_last_change_delete(lc);
+	g_object_unref(parser);
+
+	return retval;
+}
+
+static gdouble prv_time_gupnp(gchar **events, guint count, guint iterations)
+{
+	GUPnPLastChangeParser *parser;
+	gchar *strings[6];
+	guint uints[2];
+	gint64 start;
+	guint i;
+	guint j;
+
+	start = g_get_monotonic_time();
+
+	for (i = 0; i < iterations; ++i) {
+		parser = gupnp_last_change_parser_new();
+
+		for (j = 0; j < G_N_ELEMENTS(strings); ++j)
+			strings[j] = NULL;
+
+		(void) gupnp_last_change_parser_parse_last_change(
+			parser, 0, events[i % count], NULL,
+			g_av_vars[0], G_TYPE_STRING, &strings[0],
+			g_av_vars[1], G_TYPE_STRING, &strings[1],
+			g_av_vars[2], G_TYPE_STRING, &strings[2],
+			g_av_vars[3], G_TYPE_STRING, &strings[3],
+			g_av_vars[4], G_TYPE_STRING, &strings[4],
+			g_av_vars[5], G_TYPE_STRING, &strings[5],
+			g_av_vars[6], G_TYPE_UINT, &uints[0],
+			g_av_vars[7], G_TYPE_UINT, &uints[1],
+			NULL);
+
+		for (j = 0; j < G_N_ELEMENTS(strings); ++j)
+			g_free(strings[j]);
+
+		g_object_unref(parser);
+	}
+
+	return (g_get_monotonic_time() - start) / (gdouble)iterations;
+}
+
+static gdouble prv_time_streaming(gchar **events, guint count,
+				  guint iterations)
+{
+	dlr_last_change_t *lc;
+	guint value;
+	gint64 start;
+	guint i;
+	guint j;
+
+	lc = dlr_last_change_new(g_av_vars);
+
+	start = g_get_monotonic_time();
+
+	for (i = 0; i < iterations; ++i) {
+		if (!dlr_last_change_parse(lc, events[i % count], 0))
+			continue;
+
+		for (j = 0; g_av_vars[j]; ++j)
+			(void) dlr_last_change_get_uint(lc, j, &value);
+	}
+
+	dlr_last_change_delete(lc);
+
+	return (g_get_monotonic_time() - start) / (gdouble)iterations;
+}
+
+int main(int argc, char *argv[])
+{
+	GPtrArray *events;
+	guint iterations = DEFAULT_ITERATIONS;
+	gchar *contents;
+	gdouble gupnp_time;
+	gdouble streaming_time;
+	int i;
+
+	if (argc > 1)
+		iterations = MAX(atoi(argv[1]), 1);
+
+	events = g_ptr_array_new_with_free_func(g_free);
+
+	for (i = 2; i < argc; ++i) {
+		if (!g_file_get_contents(argv[i], &contents, NULL, NULL)) {
+			fprintf(stderr, "Unable to read %s\n", argv[i]);
+			return 1;
+		}
+
+		g_ptr_array_add(events, contents);
+	}
+
+	if (events->len == 0)
+		for (i = 0; i < (int)G_N_ELEMENTS(g_samples); ++i)
+			g_ptr_array_add(events, g_strdup(g_samples[i]));
+
+	if (!prv_check((const gchar *const *)events->pdata, events->len,
+		       g_av_vars, g_av_types) ||
+	    !prv_check((const gchar *const *)events->pdata, events->len,
+		       g_rc_vars, g_rc_types) ||
+	    !prv_check(g_rc_samples, G_N_ELEMENTS(g_rc_samples),
+		       g_rc_vars, g_rc_types)) {
+		fprintf(stderr, "The parsers disagree\n");
+		g_ptr_array_unref(events);
+		return 1;
+	}
+
+	gupnp_time = prv_time_gupnp((gchar **)events->pdata, events->len,
+				    iterations);
+	streaming_time = prv_time_streaming((gchar **)events->pdata,
+					    events->len, iterations);
+
+	printf("%u events, %u iterations\n", events->len, iterations);
+	printf("%-12s %10s\n", "parser", "us/event");
+	printf("%-12s %10.2f\n", "gupnp-av", gupnp_time);
+	printf("%-12s %10.2f\n", "streaming", streaming_time);
+
+	g_ptr_array_unref(events);
+
+	return 0;
+}
@@ -0,0 +1,331 @@
+/*
+ * dLeyna
+ *
+ * Copyright (C) 2012-2017 Intel Corporation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St - Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*
+ * Compares the cost of serving Get and GetAll requests from the
+ * properties of many renderers, with the properties kept in hash tables
+ * keyed by name, as the devices used to, and in the property stores
+ * generated from prop-defs.h.
+ *
+ * Build with "make test/prop-store-bench".
+ *
+ * Usage: prop-store-bench [devices] [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include "prop-store.h"
+
+#define DEFAULT_DEVICES 300
+#define DEFAULT_ITERATIONS 2000000
+#define GET_ALL_RATIO 50
+
+typedef struct prv_request_t_ prv_request_t;
+struct prv_request_t_ {
+	const gchar *interface;
+	const gchar *name;
+};
+
+typedef struct prv_hash_device_t_ prv_hash_device_t;
+struct prv_hash_device_t_ {
+	GHashTable *root_props;
+	GHashTable *player_props;
+	GHashTable *device_props;
+};
+
+typedef struct prv_store_device_t_ prv_store_device_t;
+struct prv_store_device_t_ {
+	dlr_prop_store_t *root_props;
+	dlr_prop_store_t *player_props;
+	dlr_prop_store_t *device_props;
+};
+
+#define PRV_ROOT_REQUEST(id, name) { DLR_INTERFACE_SERVER, name }, { "", name },
+#define PRV_PLAYER_REQUEST(id, name) { DLR_INTERFACE_PLAYER, name },
+#define PRV_DEVICE_REQUEST(id, name) \
+	{ DLEYNA_SERVER_INTERFACE_RENDERER_DEVICE, name },
+
+static const prv_request_t g_requests[] = {
+	DLR_ROOT_PROPS(PRV_ROOT_REQUEST)
+	DLR_PLAYER_PROPS(PRV_PLAYER_REQUEST)
+	DLR_DEVICE_PROPS(PRV_DEVICE_REQUEST)
+	{ "", DLR_INTERFACE_PROP_VOLUME },
+	{ "", DLR_INTERFACE_PROP_FRIENDLY_NAME },
+	{ DLR_INTERFACE_PLAYER, "NoSuchProperty" }
+};
+
+#define PRV_PROP_NAME(id, name) name,
+
+static const gchar *const g_root_names[] = {
+	DLR_ROOT_PROPS(PRV_PROP_NAME)
+};
+
+static const gchar *const g_player_names[] = {
+	DLR_PLAYER_PROPS(PRV_PROP_NAME)
+};
+
+static const gchar *const g_device_names[] = {
+	DLR_DEVICE_PROPS(PRV_PROP_NAME)
+};
+
+static void prv_unref_variant(gpointer variant)
+{
+	if (variant)
+		g_variant_unref(variant);
+}
+
+static GHashTable *prv_hash_new(const gchar *const *names, guint count,
+				guint device)
+{
+	GHashTable *props;
+	guint i;
+
+	props = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+				      prv_unref_variant);
+
+	for (i = 0; i < count; ++i)
+		g_hash_table_insert(props, (gchar *)names[i],
+				    g_variant_ref_sink(g_variant_new_uint32(
+							       device + i)));
+
+	return props;
+}
+
+static dlr_prop_store_t *prv_store_new(dlr_prop_table_t *table, guint count,
+				       guint device)
+{
+	dlr_prop_store_t *props;
+	guint i;
+
+	props = dlr_prop_store_new(table);
+
+	for (i = 0; i < count; ++i)
+		dlr_prop_store_set(props, i,
+				   g_variant_ref_sink(g_variant_new_uint32(
+							      device + i)));
+
+	return props;
+}
+
+static GVariant *prv_hash_get(prv_hash_device_t *dev,
+			      const prv_request_t *request)
+{
+	GVariant *res = NULL;
+
+	if (!strcmp(request->interface,
+		    DLEYNA_SERVER_INTERFACE_RENDERER_DEVICE)) {
+		res = g_hash_table_lookup(dev->device_props, request->name);
+	} else if (!strcmp(request->interface, DLR_INTERFACE_SERVER)) {
+		res = g_hash_table_lookup(dev->root_props, request->name);
+	} else if (!strcmp(request->interface, DLR_INTERFACE_PLAYER)) {
+		res = g_hash_table_lookup(dev->player_props, request->name);
+	} else if (!strcmp(request->interface, "")) {
+		res = g_hash_table_lookup(dev->root_props, request->name);
+		if (!res)
+			res = g_hash_table_lookup(dev->player_props,
+						  request->name);
+		if (!res)
+			res = g_hash_table_lookup(dev->device_props,
+						  request->name);
+	}
+
+	return res;
+}
+
+static GVariant *prv_store_get(prv_store_device_t *dev,
+			       const prv_request_t *request,
+			       const GQuark *quarks)
+{
+	GQuark interface = g_quark_try_string(request->interface);
+	GVariant *res = NULL;
+
+	if (interface == quarks[0]) {
+		res = dlr_prop_store_lookup(dev->device_props, request->name);
+	} else if (interface == quarks[1]) {
+		res = dlr_prop_store_lookup(dev->root_props, request->name);
+	} else if (interface == quarks[2]) {
+		res = dlr_prop_store_lookup(dev->player_props, request->name);
+	} else if (!request->interface[0]) {
+		res = dlr_prop_store_lookup(dev->root_props, request->name);
+		if (!res)
+			res = dlr_prop_store_lookup(dev->player_props,
+						    request->name);
+		if (!res)
+			res = dlr_prop_store_lookup(dev->device_props,
+						    request->name);
+	}
+
+	return res;
+}
+
+static void prv_hash_add_all(GHashTable *props, GVariantBuilder *vb)
+{
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+
+	g_hash_table_iter_init(&iter, props);
+
+	while (g_hash_table_iter_next(&iter, &key, &value))
+		g_variant_builder_add(vb, "{sv}", (gchar *)key,
+				      (GVariant *)value);
+}
+
+static void prv_time_hash(guint devices, guint iterations,
+			  gdouble *get_time, gdouble *get_all_time)
+{
+	prv_hash_device_t *devs = g_new0(prv_hash_device_t, devices);
+	GVariantBuilder vb;
+	gint64 start;
+	guint found = 0;
+	guint i;
+
+	for (i = 0; i < devices; ++i) {
+		devs[i].root_props = prv_hash_new(
+			g_root_names, DLR_ROOT_PROP_MAX, i);
+		devs[i].player_props = prv_hash_new(
+			g_player_names, DLR_PLAYER_PROP_MAX, i);
+		devs[i].device_props = prv_hash_new(
+			g_device_names, DLR_DEVICE_PROP_MAX, i);
+	}
+
+	start = g_get_monotonic_time();
+
+	for (i = 0; i < iterations; ++i)
+		if (prv_hash_get(&devs[i % devices],
+				 &g_requests[i % G_N_ELEMENTS(g_requests)]))
+			++found;
+
+	*get_time = (g_get_monotonic_time() - start) * 1000.0 / iterations;
+
+	start = g_get_monotonic_time();
+
+	for (i = 0; i < iterations / GET_ALL_RATIO; ++i) {
+		g_variant_builder_init(&vb, G_VARIANT_TYPE("a{sv}"));
+		prv_hash_add_all(devs[i % devices].root_props, &vb);
+		prv_hash_add_all(devs[i % devices].player_props, &vb);
+		prv_hash_add_all(devs[i % devices].device_props, &vb);
+		g_variant_unref(g_variant_ref_sink(g_variant_builder_end(&vb)));
+	}
+
+	*get_all_time = (g_get_monotonic_time() - start) /
+		(gdouble)(iterations / GET_ALL_RATIO);
+
+	for (i = 0; i < devices; ++i) {
+		g_hash_table_unref(devs[i].root_props);
+		g_hash_table_unref(devs[i].player_props);
+		g_hash_table_unref(devs[i].device_props);
+	}
+
+	g_free(devs);
+
+	if (!found)
+		fprintf(stderr, "No property found\n");
+}
+
+static void prv_time_store(guint devices, guint iterations,
+			   gdouble *get_time, gdouble *get_all_time)
+{
+	prv_store_device_t *devs = g_new0(prv_store_device_t, devices);
+	GVariantBuilder vb;
+	GQuark quarks[3];
+	gint64 start;
+	guint found = 0;
+	guint i;
+
+	quarks[0] = g_quark_from_static_string(
+				DLEYNA_SERVER_INTERFACE_RENDERER_DEVICE);
+	quarks[1] = g_quark_from_static_string(DLR_INTERFACE_SERVER);
+	quarks[2] = g_quark_from_static_string(DLR_INTERFACE_PLAYER);
+
+	for (i = 0; i < devices; ++i) {
+		devs[i].root_props = prv_store_new(
+			&dlr_prop_root_table, DLR_ROOT_PROP_MAX, i);
+		devs[i].player_props = prv_store_new(
+			&dlr_prop_player_table, DLR_PLAYER_PROP_MAX, i);
+		devs[i].device_props = prv_store_new(
+			&dlr_prop_device_table, DLR_DEVICE_PROP_MAX, i);
+	}
+
+	start = g_get_monotonic_time();
+
+	for (i = 0; i < iterations; ++i)
+		if (prv_store_get(&devs[i % devices],
+				  &g_requests[i % G_N_ELEMENTS(g_requests)],
+				  quarks))
+			++found;
+
+	*get_time = (g_get_monotonic_time() - start) * 1000.0 / iterations;
+
+	start = g_get_monotonic_time();
+
+	for (i = 0; i < iterations / GET_ALL_RATIO; ++i) {
+		g_variant_builder_init(&vb, G_VARIANT_TYPE("a{sv}"));
+		dlr_prop_store_add_all(devs[i % devices].root_props, &vb);
+		dlr_prop_store_add_all(devs[i % devices].player_props, &vb);
+		dlr_prop_store_add_all(devs[i % devices].device_props, &vb);
+		g_variant_unref(g_variant_ref_sink(g_variant_builder_end(&vb)));
+	}
+
+	*get_all_time = (g_get_monotonic_time() - start) /
+		(gdouble)(iterations / GET_ALL_RATIO);
+
+	for (i = 0; i < devices; ++i) {
+		dlr_prop_store_delete(devs[i].root_props);
+		dlr_prop_store_delete(devs[i].player_props);
+		dlr_prop_store_delete(devs[i].device_props);
+	}
+
+	g_free(devs);
+
+	if (!found)
+		fprintf(stderr, "No property found\n");
+}
+
+int main(int argc, char *argv[])
+{
+	guint devices = DEFAULT_DEVICES;
+	guint iterations = DEFAULT_ITERATIONS;
+	gdouble hash_get;
+	gdouble hash_get_all;
+	gdouble store_get;
+	gdouble store_get_all;
+
+	if (argc > 1)
+		devices = MAX(atoi(argv[1]), 1);
+
+	if (argc > 2)
+		iterations = MAX(atoi(argv[2]), GET_ALL_RATIO);
+
+	prv_time_hash(devices, iterations, &hash_get, &hash_get_all);
+	prv_time_store(devices, iterations, &store_get, &store_get_all);
+
+	printf("%u devices, %u Get and %u GetAll requests\n", devices,
+	       iterations, iterations / GET_ALL_RATIO);
+	printf("%-12s %10s %12s\n", "properties", "ns/Get", "us/GetAll");
+	printf("%-12s %10.1f %12.2f\n", "hash-table", hash_get, hash_get_all);
+	printf("%-12s %10.1f %12.2f\n", "prop-store", store_get,
+	       store_get_all);
+
+	return 0;
+}